@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Wed May 24 07:17:25 EDT 2023
+// Date:	Mon Oct 19 13:52:30 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -16,7 +16,10 @@
 //	Program Instructions
 //	Scanner Closures
 //	Scanner
+//	Parallel Scanning
+//	Incremental Scanning
 //	Printing
+//	Compiled Programs
 //	Name String Scanning
 
 // Usage and Setup
@@ -101,9 +104,123 @@ namespace ll { namespace lexeme {
 
     typedef min::packed_vec_insptr<inchar>
             input_buffer;
+
+    struct input_line
+        // Element of input_lines: see below.
+    {
+	uns32	first;
+	    // Index in input_chars of the first char-
+	    // acter of the line that is still in
+	    // input_chars.
+	min::position position;
+	uns32	indent;
+	    // Position and indent of that character.
+	uns32	byte_offsets;
+	    // Index in input_offsets of the position
+	    // offset of that character, followed by
+	    // those of the rest of the line, or NO_
+	    // BYTE_OFFSETS if the line is ASCII, in
+	    // which case the offset of input_chars
+	    // [first+k] is position.offset + k.
+    };
+    const uns32 NO_BYTE_OFFSETS = 0xFFFFFFFF;
+
+    typedef min::packed_vec_insptr<Uchar>
+            input_chars;
+    typedef min::packed_vec_insptr<uns8>
+            input_bytes;
+    typedef min::packed_vec_insptr<input_line>
+            input_lines;
+    typedef min::packed_vec_insptr<uns32>
+            input_offsets;
+    typedef min::packed_vec_insptr<uns64>
+            line_bases;
+    typedef min::packed_vec_insptr<uns32>
+            line_deltas;
+    typedef min::packed_vec_insptr<char>
+            span_text;
+
+    const uns32 LINE_INDEX_BLOCK = 64;
+        // Lines per line_bases element.
+    const uns64 NO_LINE_OFFSET = ~ (uns64) 0;
     typedef min::packed_vec_insptr<Uchar>
             translation_buffer;
 
+    struct flat_state
+        // Element of flat_states: see below.
+    {
+	uns32	dispatcher_ID;
+	    // Dispatcher flattened into this state.
+	uns32	first_transition;
+	    // Index in flat_transitions of the
+	    // transition for ctype 0.  The transition
+	    // for ctype t is at first_transition + t.
+	uns32	ctype_map_size;
+	uns32	ctype_map_ID;
+	    // Copy of the dispatcher ctype_map_size and
+	    // the program index of the dispatcher ctype
+	    // map, for non-ASCII characters.
+    };
+
+    struct flat_transition
+        // Element of flat_transitions: see below.
+    {
+	uns32	next_state;
+	    // Flat state of the map element dispatcher,
+	    // or 0 if none.
+	uns32	instruction_ID;
+	uns32	repeat_count;
+	    // Copies of map element members.
+    };
+
+    typedef min::packed_vec_insptr<flat_state>
+            flat_states;
+    typedef min::packed_vec_insptr<flat_transition>
+            flat_transitions;
+    typedef min::packed_vec_insptr<uns32>
+            flat_ascii;
+
+    typedef min::packed_vec_insptr<uns64> profile;
+	// Profile counts: see scanner->profile below.
+
+    struct checkpoint
+        // Element of checkpoints: see below.
+    {
+	uns32	line;
+	uns32	table_ID;
+	    // Line number, and the scanner current table
+	    // when a scan began at the beginning of the
+	    // line.
+    };
+
+    typedef min::packed_vec_insptr<checkpoint>
+            checkpoints;
+
+    struct memo_entry
+        // Element of memo_table: see below.
+    {
+	uns32	ID;
+	    // Atom table ID of a MATCH, or instruction
+	    // ID of a REQUIRE.
+	uns32	offset;
+	    // Input buffer offset of the scan, which
+	    // is always scanner->next.
+	uns32	result;
+	    // Instruction ID returned by the MATCH
+	    // atom table, or 1 if the REQUIRE failed
+	    // and 0 if it succeeded.
+	uns32	length;
+	    // Atom length recognized by the MATCH, or
+	    // the atom length given the REQUIRE.
+	uns32	translation_first;
+	uns32	translation_length;
+	    // Translation added by the MATCH is
+	    // memo_translations[first .. first+length-1].
+    };
+
+    typedef min::packed_vec_insptr<memo_entry>
+            memo_table;
+
     struct scanner_struct;
     typedef min::packed_struct_updptr<scanner_struct>
             scanner;
@@ -135,6 +252,35 @@ namespace ll { namespace lexeme {
         // Default value for scanner->erroneous_atom.
 	// Prints error message to scanner->printer.
 
+    struct compiled_program;
+	// See `Compiled Programs' below.
+
+    struct read_ahead_stream
+    {
+	// Base of the stream made by init_input_read_
+	// ahead (see scanner->read_ahead below).
+
+	int error;
+	    // errno of a failed read, or 0.  A read
+	    // error ends the input and sets the badbit
+	    // of the stream.
+
+	static int active;
+	    // Number of read_ahead_streams that exist,
+	    // each of which has a reader thread.
+	    // scan_parallel does not fork while this is
+	    // not 0.
+
+	read_ahead_stream ( void ) : error ( 0 )
+	{
+	    ++ active;
+	}
+	virtual ~ read_ahead_stream ( void )
+	{
+	    -- active;
+	}
+    };
+
 } }
 
 // Program Construction
@@ -161,7 +307,8 @@ namespace ll { namespace lexeme {
 	PROGRAM			= 1,
 	TABLE			= 2,
 	DISPATCHER		= 3,
-	INSTRUCTION		= 4
+	INSTRUCTION		= 4,
+	CTYPE_PAGE		= 5
     };
 
     // Return the type of the component at the given
@@ -263,6 +410,12 @@ namespace ll { namespace lexeme {
     // ctypes are 0 .. max_ctype, and 0 is the default
     // ctype for any character not mapped by a type map.
     //
+    // If ctype_map_size > TWO_LEVEL_MAP_THRESHOLD the
+    // ctype map has two levels, with non-zero pages in
+    // shared CTYPE_PAGE components created before the
+    // dispatcher (see ll_lexeme_program_data.h).
+    //
+    const uns32 TWO_LEVEL_MAP_THRESHOLD = 4096;
     uns32 create_dispatcher
 	    ( uns32 line_number,
 	      uns32 max_ctype,
@@ -304,6 +457,9 @@ namespace ll { namespace lexeme {
 	      uns32 output_type = 0,
 	      uns32 goto_table_ID = 0,
 	      uns32 call_table_ID = 0,
+	      uns32 skip_to_length = 0,
+	      min::ptr<Uchar> skip_to_vector =
+	          NULL_TV(),
 	      ll::lexeme::program program =
 	          default_program );
 
@@ -375,6 +531,52 @@ namespace ll { namespace lexeme {
     bool convert_program_endianhood
 	    ( ll::lexeme::program program =
 	        default_program );
+
+    // Write the program to the named file as a program
+    // image (see ll_lexeme_program_data.h).  If the file
+    // cannot be written, an error message is written to
+    // min::error_message and false is returned.
+    //
+    bool write_program_image
+	    ( const char * file_name,
+	      ll::lexeme::program program =
+	          default_program );
+
+    // Read the program image in the named file into
+    // the program, creating the program if it is NULL_
+    // STUB, and convert its endianhood.  On error
+    // write min::error_message and return false.
+    //
+    bool read_program_image
+	    ( const char * file_name,
+	      min::ref<ll::lexeme::program> program =
+	          default_program );
+
+    // Verify that the program components, the IDs
+    // in them, and the ctype map elements are legal,
+    // and that CALLs and MATCHes are not recursive or
+    // nested too deep.  On error write complete lines
+    // to min::error_message and return false.  Used
+    // by init_program to set scanner->verified.
+    //
+    bool verify_program
+	    ( ll::lexeme::program program =
+	        default_program );
+
+    // Optimize a finished program in place: remove
+    // unreachable dispatchers and instructions, merge
+    // identical ones, and renumber and truncate ctype
+    // maps.  Component IDs change, so do this before
+    // init_program or print_compiled_program.  If
+    // printer is not NULL_STUB print a line with the
+    // lengths before and after.  Return false and
+    // write min::error_message if the program does
+    // not verify.
+    //
+    bool optimize_program
+	    ( ll::lexeme::program program =
+	          default_program,
+	      min::printer printer = min::NULL_STUB );
 } }
 
 // Program Instructions
@@ -418,6 +620,22 @@ namespace ll { namespace lexeme {
     //			the atom is retained as input to
     //			be rescanned.  0 <= n < 32.
     //
+    //	 SKIP_TO(n)	Extend the atom by the printing
+    //			ASCII characters (space through
+    //			`~') following it, up to but not
+    //			including the first of the n
+    //			characters of the skip_to_vector
+    //			or the end of input.  Control
+    //			and non-ASCII characters also
+    //			stop the skip, so the table can
+    //			dispatch them.  Done after any
+    //			KEEP, and the skipped characters
+    //			are translated with the rest of
+    //			the atom.  CANNOT be used with
+    //			MATCH, TRANSLATE_HEX, TRANSLATE_
+    //			OCT, TRANSLATE_NAME, or REQUIRE.
+    //			0 < n <= SKIP_TO_MAX_LENGTH.
+    //
     //	 TRANSLATE_TO(n)
     //			Instead of copying the atom into
     //			the translation buffer, copy the
@@ -545,8 +763,13 @@ namespace ll { namespace lexeme {
 	RETURN			= ( 1 << 11 ),
 	FAIL			= ( 1 << 12 ),
 	ELSE			= ( 1 << 13 ),
+	SKIP_TO			= ( 1 << 14 ),
     };
 
+    // Maximum number of SKIP_TO delimiter characters.
+    //
+    const uns32 SKIP_TO_MAX_LENGTH = 8;
+
     // Instruction component lengths are stored in bits
     // 16-31 of an instruction operation as per:
     //
@@ -807,6 +1030,27 @@ namespace ll { namespace lexeme {
 	min::position next_position;
 	min::uns32 next_indent;
 
+	// If compact_input (below) is true, the input
+	// characters are kept in input_chars instead of
+	// the input buffer, with one input_lines element
+	// per line from which input_position and input_
+	// indent are computed.  Input_offsets holds the
+	// offsets of non-ASCII lines.  NULL_STUB until
+	// compact_input is first used.
+	//
+	const ll::lexeme::input_chars input_chars;
+	const ll::lexeme::input_lines input_lines;
+	const ll::lexeme::input_offsets input_offsets;
+
+	// If ascii_input (below) is also true, ASCII
+	// input is kept as bytes in input_bytes, and
+	// byte_input is true, until a non-ASCII charac-
+	// ter moves it to input_chars.  NULL_STUB until
+	// ascii_input is first used.
+	//
+	const ll::lexeme::input_bytes input_bytes;
+	bool byte_input;
+
 	// The translation buffer holds the translation
 	// of the current lexeme.  For example, if the
 	// lexeme is a quoted string lexeme, the quotes
@@ -918,6 +1162,54 @@ namespace ll { namespace lexeme {
 	//
 	const min::file input_file;
 
+	// If the input is a memory mapped file (see
+	// init_input_mapped_file), the mapped bytes,
+	// their number, and the offset of the next line
+	// to be read; else mapped_data is NULL.  Released
+	// by close_input.
+	//
+	const char * mapped_data;
+	uns64 mapped_size;
+	uns64 mapped_next;
+
+	// If the input is read ahead (see init_input_
+	// read_ahead), the stream read by input_file,
+	// else NULL.  Closed by close_input.
+	//
+	ll::lexeme::read_ahead_stream * read_ahead;
+
+	// If index_lines (below) is true, the line index
+	// of the input file.  The byte offset in the
+	// file of the beginning of line n is
+	//
+	//	line_bases[n/LINE_INDEX_BLOCK]
+	//    + line_deltas[n]
+	//
+	// for each line n read so far (see line_
+	// offset), and index_next is the byte offset of
+	// the next line.  Offsets assume the input file
+	// bytes are the line bytes each followed by a
+	// line feed, as for a UTF-8 file read with no
+	// line_format.
+	//
+	// NULL_STUB until index_lines is first used, and
+	// set empty by scanner initialization functions.
+	//
+	const ll::lexeme::line_bases line_bases;
+	const ll::lexeme::line_deltas line_deltas;
+	uns64 index_next;
+
+	// If the input was set by init_input_span, the
+	// UTF-8 text being scanned and the offset in it
+	// of the next line to read.  Span_text is reused
+	// by later init_input_span calls.
+	//
+	// NULL_STUB until init_input_span is first
+	// used.
+	//
+	const ll::lexeme::span_text span_text;
+	uns32 span_next;
+
 	// Closure to call with an erroneous atom as per
 	// ERRONEOUS_ATOM instruction flag.  The atom is
 	// in
@@ -951,6 +1243,59 @@ namespace ll { namespace lexeme {
 	//
 	uns32 trace;
 
+	// If true, scan checks the program as it
+	// executes it even if the program has been
+	// verified; for debugging.  False when the
+	// scanner is created, and not changed by
+	// scanner initialization functions.
+	//
+	bool checked;
+
+	// If true, the results of MATCH and REQUIRE
+	// components are remembered in the memo_table
+	// until scanner->next advances, so ones repeated
+	// at the same offset are reused.  False when the
+	// scanner is created, and not changed by scanner
+	// initialization functions.
+	//
+	bool memo;
+
+	// If true, the translation buffer is left empty
+	// while the translation is a copy of the input,
+	// and translation_is_identity is set instead
+	// (see expand_translation).  False when the
+	// scanner is created, and not changed by scanner
+	// initialization functions.
+	//
+	bool lazy_translation;
+
+	// If true, keep input in input_chars (see
+	// above).  Compiled programs are then not used.
+	// False when the scanner is created, and only
+	// changed by the user just after the scanner is
+	// (re)initialized.
+	//
+	bool compact_input;
+
+	// If true and compact_input is true, keep ASCII
+	// input as bytes (see input_bytes above).  As
+	// one non-ASCII character moves all unscanned
+	// input to input_chars until a shift leaves only
+	// ASCII lines, input with frequent non-ASCII
+	// characters gains little.  False when the
+	// scanner is created, and only changed by the
+	// user just after the scanner is (re)initialized.
+	//
+	bool ascii_input;
+
+	// If true, build the line index (see line_
+	// bases above) as lines are read by the default
+	// input closure.  False when the scanner is
+	// created, and only changed by the user just
+	// after the scanner is (re)initialized.
+	//
+	bool index_lines;
+
 	// Scanner state:
 
 	bool reinitialize;
@@ -964,6 +1309,106 @@ namespace ll { namespace lexeme {
 	    // of the first yet unscanned atom.
 	uns32 current_table_ID;
 	    // Current table ID.
+	bool verified;
+	    // Set by init_program to the value of
+	    // verify_program ( program ).  If true and
+	    // `checked' is false, scan omits the checks
+	    // made by verify_program.
+	bool translation_is_identity;
+	    // True if lazy_translation is true and the
+	    // translation of the current lexeme is
+	    // input_buffer[lexeme_first .. next-1],
+	    // which is not copied to the translation
+	    // buffer.
+	uns32 lexeme_first;
+	    // input_buffer[lexeme_first] is the first
+	    // character of the current lexeme.
+	uns32 erroneous_atom_count;
+	    // Number of erroneous atoms announced; used
+	    // to avoid memoizing MATCHes that announce
+	    // them.
+	const ll::lexeme::memo_table memo_table;
+	const ll::lexeme::translation_buffer
+	    memo_translations;
+	    // Memo entries for the current scanner->
+	    // next (see `memo' above), and the trans-
+	    // lations they hold.  NULL_STUB until first
+	    // used, and emptied whenever scanner->next
+	    // changes.
+
+	// The program dispatchers flattened by init_
+	// program: one flat state per dispatcher,
+	// numbered from 1, with one flat transition per
+	// ctype.  flat_ascii[128*s+c] is the index of
+	// the transition of state s for ASCII character
+	// c.  Used when dispatch is not traced; left
+	// empty if the program has a bad map element so
+	// the interpreter can report it.
+	//
+	const ll::lexeme::flat_states flat_states;
+	const ll::lexeme::flat_transitions
+	    flat_transitions;
+	const ll::lexeme::flat_ascii flat_ascii;
+
+	// Compiled dispatch code for the program, or
+	// NULL if none.  Set to NULL by init_program
+	// and set by init_compiled_program.  Not used
+	// if trace has the TRACE_DISPATCH flag.
+	//
+	const ll::lexeme::compiled_program * compiled;
+
+	// Profile counts, or NULL_STUB if the scanner
+	// is not profiling.  Set by init_profile, and
+	// resized and zeroed by init_program.  While
+	// profiling, characters are dispatched by
+	// the program dispatchers (as if dispatch were
+	// traced) so each can be counted.
+	//
+	// The counts have one element per program
+	// element and are indexed by program offset:
+	//
+	//   Table ID	   Number of atom scans by the
+	//		   table.
+	//   Table ID+1	   Number of characters in the
+	//		   atoms scanned by the table.
+	//   Table ID+2	   Clock ticks spent in the table
+	//		   if profile_time is true.
+	//   Dispatcher ID Number of characters dispatch-
+	//		   ed by the dispatcher, including
+	//		   REQUIRE dispatching.
+	//   Map element   Number of those characters whose
+	//   ID		   ctype selected the map element.
+	//   Instruction   Number of executions of the
+	//   ID		   instruction.
+	//   Instruction   Number of those executions that
+	//   ID+1	   failed.
+	//   Instruction   Number of memo lookups and hits
+	//   ID+2, ID+3	   for the MATCH of the instruc-
+	//		   tion, if memo is true.
+	//   Instruction   Ditto for the REQUIRE of the
+	//   ID+4, ID+5	   instruction.
+	//
+	// Counts and ticks for a table include those of
+	// the atom tables it MATCHes.
+	//
+	const ll::lexeme::profile profile;
+	bool profile_time;
+
+	// Line checkpoints, or NULL_STUB if they are
+	// not being recorded.  Set by init_checkpoints.
+	// When a scan begins at the beginning of a line
+	// after the line of the last checkpoint, the
+	// line and the current table are pushed.  As
+	// the return stack is empty between lexemes, and
+	// set_lexical_master just sets the current
+	// table, this is all the state needed to resume
+	// scanning at the line.
+	//
+	// Not emptied by scanner initialization, so the
+	// checkpoints survive giving the scanner edited
+	// input: see rescan_lines.
+	//
+	const ll::lexeme::checkpoints checkpoints;
     };
 
     MIN_REF ( ll::lexeme::input_buffer, input_buffer,
@@ -987,19 +1432,139 @@ namespace ll { namespace lexeme {
               ll::lexeme::scanner )
     MIN_REF ( min::printer, printer,
               ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::flat_states, flat_states,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::flat_transitions,
+              flat_transitions,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::flat_ascii, flat_ascii,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::profile, profile,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::memo_table, memo_table,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::translation_buffer,
+              memo_translations,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::input_chars, input_chars,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::input_lines, input_lines,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::input_offsets, input_offsets,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::input_bytes, input_bytes,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::line_bases, line_bases,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::line_deltas, line_deltas,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::span_text, span_text,
+              ll::lexeme::scanner )
+    MIN_REF ( ll::lexeme::checkpoints, checkpoints,
+              ll::lexeme::scanner )
+
+    // Return the number of characters in the input,
+    // and the character at input index i, reading
+    // input_bytes if scanner->byte_input is true,
+    // else input_chars if scanner->compact_input is
+    // true, else the input buffer.
+    //
+    inline uns32 input_length
+	    ( ll::lexeme::scanner scanner )
+    {
+        if ( ! scanner->compact_input )
+	    return scanner->input_buffer->length;
+	else if ( scanner->byte_input )
+	    return scanner->input_bytes->length;
+	else
+	    return scanner->input_chars->length;
+    }
+    inline Uchar input_character
+	    ( ll::lexeme::scanner scanner, uns32 i )
+    {
+        if ( ! scanner->compact_input )
+	    return (&scanner->input_buffer[i])
+	               ->character;
+	else if ( scanner->byte_input )
+	    return scanner->input_bytes[i];
+	else
+	    return scanner->input_chars[i];
+    }
+
+    // Return the position and the indent of the
+    // character at input index i, or scanner->next_
+    // position and next_indent if i >= input_length
+    // ( scanner ).
+    //
+    min::position input_position
+	    ( ll::lexeme::scanner scanner, uns32 i );
+    uns32 input_indent
+	    ( ll::lexeme::scanner scanner, uns32 i );
+
+    // Return the byte offset in the input file of the
+    // beginning of the line with the given line number
+    // using the line index (see scanner->line_bases),
+    // or NO_LINE_OFFSET if the line is not indexed.
+    //
+    inline uns64 line_offset
+	    ( ll::lexeme::scanner scanner, uns32 line )
+    {
+        ll::lexeme::line_deltas deltas =
+	    scanner->line_deltas;
+	if ( deltas == min::NULL_STUB
+	     ||
+	     line >= deltas->length )
+	    return NO_LINE_OFFSET;
+	return   scanner->line_bases
+	             [line / LINE_INDEX_BLOCK]
+	       + deltas[line];
+    }
+
+    // Return the position of the given byte offset in
+    // the input file using the line index, which must
+    // contain the offset.
+    //
+    min::position offset_position
+	    ( ll::lexeme::scanner scanner, uns64 offset );
 
     // Simply (re)initialize a scanner.
     //
     void init ( min::ref<ll::lexeme::scanner> scanner );
 
     // Initialize the scanner and set the scanner
-    // program.
+    // program.  Also verify the program and build the
+    // scanner flat_states, flat_transitions, and
+    // flat_ascii from the program, unless the program
+    // is unchanged since the last init_program, in
+    // which case the last results are reused.
     //
     void init_program
 	    ( min::ref<ll::lexeme::scanner> scanner,
               ll::lexeme::program program,
 	      ll::lexeme::uns32 initial_table = 0 );
 
+    // Turn scanner profiling on with all counts zero,
+    // or off if profile is false.  If time is true,
+    // also accumulate clock ticks per table; this
+    // reads the clock twice per atom.  Unlike other
+    // init_... functions this does not reinitialize
+    // the scanner, and may be called between scans.
+    // See scanner->profile.
+    //
+    void init_profile
+	    ( min::ref<ll::lexeme::scanner> scanner,
+	      bool profile = true,
+	      bool time = false );
+
+    // Turn recording of line checkpoints on with no
+    // checkpoints, or off if checkpoints is false.
+    // Like init_profile this does not reinitialize the
+    // scanner.  See scanner->checkpoints.
+    //
+    void init_checkpoints
+	    ( min::ref<ll::lexeme::scanner> scanner,
+	      bool checkpoints = true );
+
     // Reinitialized the scanner and set the scanner->
     // input_file as per min:: function of the same
     // name.
@@ -1025,6 +1590,66 @@ namespace ll { namespace lexeme {
 	                               NULL,
 	      uns32 spool_lines = min::ALL_LINES );
 
+    // Like init_input_string but for the many short
+    // strings scanned by scan_name_string.  The length
+    // bytes of data are copied to scanner->span_text
+    // and read from there, without reading or spool-
+    // ing lines in scanner->input_file.  The input_
+    // file gives no file name, and is reinitialized
+    // only when it holds lines or has a different
+    // line_format.  It is given the span lines only
+    // if they are printed by print_phrase_lines, so
+    // error messages are as for init_input_string.
+    //
+    void init_input_span
+	    ( min::ref<ll::lexeme::scanner> scanner,
+	      min::ptr<const char> data, uns32 length,
+	      const min::line_format * line_format =
+	                               NULL );
+
+    // Reinitialize the scanner and memory map the
+    // named file read-only as the scanner input (see
+    // scanner->mapped_data).  Scanner->input_file is
+    // initialized as per min::init_input with the
+    // file name, and is given each line as it is
+    // read.  Lines end with a line feed and are
+    // UTF-8.  Return false and write min::error_
+    // message if the file cannot be mapped.
+    //
+    bool init_input_mapped_file
+	    ( min::ref<ll::lexeme::scanner> scanner,
+	      min::gen file_name,
+	      const min::line_format * line_format =
+	                               NULL,
+	      uns32 spool_lines = min::ALL_LINES );
+
+    // Reinitialize the scanner and set the scanner->
+    // input_file to read the named file as per min::
+    // init_input_stream, from a stream whose bytes are
+    // read ahead by a background thread (see scanner->
+    // read_ahead).  Return false and write min::error_
+    // message if the file cannot be opened.
+    //
+    // Defined in ll_lexeme_read_ahead.cc, which is not
+    // in liblayered.a: a program using it must link
+    // lib/ll_lexeme_read_ahead.o (`make read_ahead')
+    // and -pthread.
+    //
+    bool init_input_read_ahead
+	    ( min::ref<ll::lexeme::scanner> scanner,
+	      min::gen file_name,
+	      const min::line_format * line_format =
+	                               NULL,
+	      uns32 spool_lines = min::ALL_LINES );
+
+    // Release any memory mapped input file or read
+    // ahead stream and stop using it as input.  Called
+    // by the init_input_... functions and by those of
+    // the parser; other scanner initializations just
+    // rewind a mapped file.
+    //
+    void close_input ( ll::lexeme::scanner scanner );
+
     void init_input
 	    ( min::ref<ll::lexeme::scanner> scanner,
 	      const min::line_format * line_format =
@@ -1087,6 +1712,35 @@ namespace ll { namespace lexeme {
 	      ll::lexeme::scanner scanner =
 	          default_scanner );
 
+    // Scan up to n lexemes as if by calling scan,
+    // store them in lexemes[0 .. r-1], and return r.
+    // Translations are appended to `translations'.
+    // The input buffer is not shifted after the first
+    // lexeme, so the first and next offsets stay
+    // valid until the next scan or scan_batch.
+    //
+    // Stop early after a lexeme of type t < 64 with
+    // bit ( 1 << t ) set in stop_types (e.g., so the
+    // lexical master can be changed after an indent),
+    // or after a SCAN_ERROR, which is stored as a
+    // last lexeme of zero length as per scan.
+    //
+    struct batch_lexeme
+    {
+        uns32 type;
+	uns32 first, next;
+	uns32 translation_offset;
+	uns32 translation_length;
+    };
+    uns32 scan_batch
+            ( ll::lexeme::batch_lexeme * lexemes,
+	      uns32 n,
+	      ll::lexeme::translation_buffer
+	          translations,
+	      uns64 stop_types = 0,
+	      ll::lexeme::scanner scanner =
+	          default_scanner );
+
     // Return index of a lexical master given the name
     // of the master.  Return MISSING_MASTER if none.
     //
@@ -1148,6 +1802,123 @@ namespace ll { namespace lexeme {
     }
 } }
 
+// Parallel Scanning
+// -------- --------
+
+namespace ll { namespace lexeme {
+
+    // Mapped file or span input can be scanned by
+    // several worker processes at once.  The input is
+    // split into chunks that begin at line beginnings.
+    // The calling process scans chunk 0, and a forked
+    // worker scans each later chunk, starting in the
+    // `seam table': the current table of the scanner
+    // when it is first between lexemes at a line
+    // beginning (for the standard program, the table
+    // that scans indents).  A worker that reaches a
+    // later chunk between lexemes in the seam table
+    // stops there; otherwise it scans on.  Stitching
+    // the chunks together then gives the same result
+    // as a serial scan.
+    //
+    // Processes are used rather than threads as the MIN
+    // garbage collector is not thread safe.
+    //
+    struct parallel_lexeme
+    {
+        uns32 type;
+	min::position begin, end;
+	    // Positions of the first character of the
+	    // lexeme and of the character just after
+	    // the lexeme.
+	uns32 translation_offset;
+	uns32 translation_length;
+    };
+    typedef min::packed_vec_insptr<parallel_lexeme>
+            parallel_lexemes;
+
+    // Scan the mapped file or span input of the
+    // scanner to the end of file lexeme of type end_
+    // of_file_t, and append the lexemes to `lexemes'
+    // and their translations to `translations' (either
+    // is created if NULL_STUB).  Return true on
+    // success.  On a SCAN_ERROR, append it as the last
+    // lexeme with zero length and no translation, and
+    // return false with the error message in min::
+    // error_message.
+    //
+    // Forking is opt in: there are up to workers-1
+    // workers, capped so there are no more processes
+    // than CPUs, and none at all while a read_ahead_
+    // stream exists or the scanner is tracing or
+    // profiling.  The caller must have no other
+    // threads if workers > 1.  A chunk whose worker
+    // failed or found erroneous atoms is rescanned by
+    // the calling process, so these are announced as
+    // in a serial scan.
+    //
+    // The scanner is reinitialized and line check-
+    // points are turned off.  On return it is at the
+    // end of file, and for mapped input all lines of
+    // the file are in scanner->input_file.
+    //
+    bool scan_parallel
+	    ( min::ref<ll::lexeme::parallel_lexemes>
+	          lexemes,
+	      min::ref<ll::lexeme::translation_buffer>
+	          translations,
+	      uns32 end_of_file_t,
+	      uns32 workers,
+	      min::ref<ll::lexeme::scanner> scanner =
+	          default_scanner );
+} }
+
+// Incremental Scanning
+// ----------- --------
+
+namespace ll { namespace lexeme {
+
+    // Given the lexemes and translations of an input,
+    // as per scan_parallel, and the scanner->check-
+    // points recorded when they were scanned, rescan
+    // the input after an edit that replaced old lines
+    // first_line .. old_next_line-1 by new lines
+    // first_line .. new_next_line-1.  The scanner
+    // input must already hold the edited text, and
+    // must have been set by init_input_span or init_
+    // input_mapped_file.
+    //
+    // Scanning resumes at the last checkpoint at or
+    // before first_line, and stops at the end of file
+    // lexeme of type end_of_file_t or at a line at or
+    // after new_next_line whose old checkpoint has the
+    // current table.  Then old lexemes first .. old_
+    // next-1 have been replaced by new lexemes first
+    // .. new_next-1, and later lexemes and check-
+    // points have had their lines moved.
+    //
+    // With no checkpoints the whole input is scanned.
+    // A SCAN_ERROR is appended as per scan_parallel,
+    // later old lexemes are discarded, and false is
+    // returned.  The scanner must be reinitialized
+    // before it scans again.
+    //
+    bool rescan_lines
+	    ( min::ref<ll::lexeme::parallel_lexemes>
+	          lexemes,
+	      min::ref<ll::lexeme::translation_buffer>
+	          translations,
+	      uns32 first_line,
+	      uns32 old_next_line,
+	      uns32 new_next_line,
+	      uns32 end_of_file_t,
+	      uns32 & first,
+	      uns32 & old_next,
+	      uns32 & new_next,
+	      min::ref<ll::lexeme::scanner> scanner =
+	          default_scanner );
+} }
+
 // Printing
 // --------
 
@@ -1247,12 +2018,23 @@ namespace ll { namespace lexeme {
               uns32 first, uns32 next );
 
     // Return true if the translation buffer holds a
-    // copy of scanner->input_buffer[first .. next-1].
+    // copy of scanner->input_buffer[first .. next-1],
+    // or would if it were expanded.
     //
     bool translation_is_exact
 	    ( ll::lexeme::scanner scanner,
 	      uns32 first, uns32 next );
 
+    // If scanner->translation_is_identity, copy the
+    // input characters of the current lexeme into the
+    // translation buffer and clear translation_is_
+    // identity.  Otherwise do nothing.  Must be called
+    // before the next scan.
+    //
+    void expand_translation
+	    ( ll::lexeme::scanner scanner =
+	          default_scanner );
+
     // Return min::phrase_position of phrase in
     // scanner->input_buffer[first .. next-1].  If
     // input_buffer[first] or input_buffer[next-1] does
@@ -1263,7 +2045,8 @@ namespace ll { namespace lexeme {
 	  uns32 first, uns32 next );
 
     // Call min::print_phrase_lines using above phrase
-    // position.
+    // position.  Span input lines are first given to
+    // scanner->input_file (see init_input_span).
     //
     void print_phrase_lines
 	    ( min::printer,
@@ -1297,6 +2080,18 @@ namespace ll { namespace lexeme {
 	      min::uns32 ID,
 	      bool cooked );
 
+    // Ditto print_program but follow each component
+    // with its counts from the profile (see scanner->
+    // profile).  Components whose counts are all zero
+    // are omitted if hot_only is true.
+    //
+    void print_program_profile
+    	    ( min::printer printer,
+	      ll::lexeme::program program,
+	      ll::lexeme::profile profile,
+	      bool cooked = true,
+	      bool hot_only = false );
+
     // Return the length of the program component with
     // the given ID.  Used to skip over components.
     //
@@ -1340,6 +2135,98 @@ min::printer operator <<
           const ll::lexeme::perroneous_atom &
 	      perroneous_atom );
 
+// Compiled Programs
+// -------- --------
+
+// A lexical program can be compiled into C++ code that
+// dispatches the characters of an atom and executes
+// its instruction.  Instructions that MATCH, REQUIRE,
+// SKIP_TO, do hex, octal, or name translations, or
+// announce erroneous atoms are left to the inter-
+// preter.  The code holds the program, and is used
+// only with a program of the same length and hash.
+
+namespace ll { namespace lexeme {
+
+    struct compiled_program
+    {
+        uns32 length;
+	    // program->length of the compiled program.
+        uns32 hash;
+	    // program_hash of the compiled program.
+	const uns32 * program;
+	    // The length uns32 elements of the compiled
+	    // program.
+
+	void (* dispatch )
+	    ( uns32 dispatcher_ID,
+	      uns32 & instruction_ID,
+	      uns32 & atom_length,
+	      uns32 & length,
+	      ll::lexeme::scanner scanner );
+	    // Dispatch the characters beginning at
+	    // input_buffer[next + length] from the
+	    // given dispatcher as the interpreter does,
+	    // updating length, instruction_ID, and
+	    // atom_length.
+
+	bool (* execute )
+	    ( uns32 instruction_ID,
+	      uns32 & atom_length,
+	      ll::lexeme::scanner scanner );
+	    // Execute the instruction exactly as the
+	    // scanner interpreter does and return true,
+	    // or return false if the instruction was
+	    // not compiled or is in error.
+    };
+
+    // Return a hash of the program's uns32 elements.
+    //
+    uns32 program_hash ( ll::lexeme::program program );
+
+    // Set scanner->compiled to the compiled program and
+    // return true if the compiled program was compiled
+    // from scanner->program.  Otherwise set scanner->
+    // compiled to NULL and return false.  Must be
+    // called after init_program.  Compiled may be NULL.
+    //
+    bool init_compiled_program
+	    ( ll::lexeme::scanner scanner,
+	      const ll::lexeme::compiled_program *
+	          compiled );
+
+    // Copy the program of the compiled program into
+    // the program, creating the program if it is NULL_
+    // STUB, and convert its endianhood.  Return false
+    // if compiled is NULL or the conversion fails.
+    //
+    bool read_compiled_program
+	    ( const ll::lexeme::compiled_program *
+	          compiled,
+	      min::ref<ll::lexeme::program> program =
+	          default_program );
+
+    // Print C++ code for the compiled program to the
+    // output stream, including the program elements.
+    // The code #includes the given header, which
+    // should declare
+    //
+    //	    extern const ll::lexeme::compiled_program
+    //		   NAME;
+    //
+    // and defines NAME.  Return true if no error.
+    // Return false but write an error message con-
+    // sisting of one or more complete lines to min::
+    // error_message if the program is malformed.
+    //
+    bool print_compiled_program
+	    ( std::ostream & out,
+	      ll::lexeme::program program,
+	      const char * name,
+	      const char * header = "ll_lexeme.h" );
+
+} }
+
 // Name String Scanning
 // ---- ------ --------
 
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_ndl.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Fri Jul 14 04:58:19 EDT 2017
+// Date:	Mon Oct 19 10:31:48 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -218,6 +218,7 @@
 //
 //   <instruction> ::= [<match-component>]
 //		       [<keep-component>]
+//		       [<skip-to-component>]
 //		       [<translate-component>]
 //		       [<require-component>]
 //		       [<erroneous-atom-component>]
@@ -242,6 +243,22 @@
 //	     // Keep only first <n> characters of the
 //	     // matched atom.
 //
+//   <skip-to-component> ::=
+//	  NDL::skip_to ( <ascii-delimiters> );
+//	     // Extend the (kept) atom by the following
+//	     // printing ASCII characters up to but not
+//	     // including the first of the <ascii-
+//	     // delimiters>, or up to end of input.
+//	     // Control and non-ASCII characters also
+//	     // end the skip.  At most ll::lexeme::
+//	     // SKIP_TO_MAX_LENGTH delimiters.  Con-
+//	     // flicts with match(), translate_oct/hex/
+//	     // name(), and require().
+//      | NDL::skip_to
+//                  ( <n>, <UNICODE-delimiters> );
+//	     // Ditto but for <n> UNICODE delimiters,
+//	     // of which only the ASCII ones matter.
+//
 //   <translate-component> ::=
 //	  NDL::translate_to
 //                  ( <ascii-translation-string> );
@@ -272,6 +289,10 @@
 //         C++ const char * string
 //   <UNICODE-translation-string> ::=
 //         C++ const Uchar * string
+//   <ascii-delimiters> ::=
+//         C++ const char * string
+//   <UNICODE-delimiters> ::=
+//         C++ const Uchar * string
 //
 //   <require-component> ::=
 //	  NDL::require ( <atom-pattern-name> );
@@ -404,6 +425,10 @@ namespace ll { namespace lexeme { namespace ndl {
     void accept ( void );
     void keep ( uns32 n );
 
+    void skip_to ( const char * delimiters );
+    void skip_to
+        ( uns32 n, const Uchar * delimiters );
+
     void translate_to
         ( const char * translation_string );
     void translate_to
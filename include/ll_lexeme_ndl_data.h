@@ -3,7 +3,7 @@
 //
 // File:	ll_lexeme_ndl_data.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Fri Jul 14 05:09:08 EDT 2017
+// Date:	Sun Oct 18 22:24:15 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -38,7 +38,7 @@ namespace ll { namespace lexeme
     // 		dispatchers stack
     // 		instructions stack
     // 		uns32_stack
-    // 		uns8_stack
+    // 		interval_stack
     //
     // A begin_table, begin_dispatcher, and begin_atom_
     // pattern push a dispatcher to the dispatchers
@@ -51,15 +51,19 @@ namespace ll { namespace lexeme
     // correspondence.  An end_table, end_dispatcher,
     // and end_atom_pattern pop these stacks.
     //
-    // Whenever a dispatcher is pushed a CTYPE_MAP_SIZE
-    // vector is allocated to (pushed to the end of) the
-    // uns8_stack to hold the character type map (ctype_
-    // map) of the dispatcher.  Popping the dispatcher
-    // pops its ctype_map vector.  The only reason there
-    // is a separate vector is that CTYPE_MAP_SIZE is
-    // not a compile constant so its awkward to include
-    // a dispatcher's ctype_map inside the dispatcher
-    // struct.
+    // Each dispatcher has a character type map (ctype_
+    // map) represented as a sorted list of disjoint
+    // ctype_intervals, each mapping a range of charac-
+    // ter indices to a non-zero ctype, that is kept in
+    // the interval_stack.  The lists of the dispatchers
+    // are in dispatcher stack order, so the topmost
+    // dispatcher's list is at the end of the interval_
+    // stack.  Characters are only added to the ctype_
+    // map of the SECOND from topmost dispatcher, and
+    // only while the topmost dispatcher's list is
+    // empty, so the list being edited is always at the
+    // end of the interval_stack.  Popping the dispat-
+    // cher pops its list.
     //
     // A dispatcher D has a character type counter (max_
     // type_code) initialized to 0.  When a subdispatch-
@@ -147,7 +151,15 @@ namespace ll { namespace lexeme
     // topmost.  All characters added have character
     // type 1, and there are no instructions.
     //
-    extern min::packed_vec_insptr<uns8> uns8_stack;
+    struct ctype_interval
+    {
+        uns32 first, next;
+	    // Character indices first .. next-1.
+	uns32 ctype;
+	    // Non-zero ctype of these indices.
+    };
+    extern min::packed_vec_insptr<ctype_interval>
+           interval_stack;
     extern min::packed_vec_insptr<uns32> uns32_stack;
 
     // Accumulated information use to construct a
@@ -188,19 +200,20 @@ namespace ll { namespace lexeme
 	bool is_others_dispatcher;
 	    // True if and only if this is an OTHER's
 	    // dispatcher.
-        uns32 ctype_map_offset;
-	    // Offset of dispatcher ctype_map in
-	    // uns8_stack.  The ctype_map has size
-	    // CTYPE_MAP_SIZE.
+        uns32 interval_count;
+	    // Number of ctype_intervals in the ctype_
+	    // map list of this dispatcher in the
+	    // interval_stack.  Cindices not in any
+	    // interval have ctype 0.
 	    //
 	    // Subdispatchers modify this ctype_map when
 	    // they add characters to their character
 	    // patterns via their begin_dispatcher call
 	    // or add_char... calls.
 	    //
-	    // The ctype_map is truncated when it is
-	    // used to create the actual dispatcher by
-	    // removing 0 elements from its end.
+	    // The ctype_map is expanded to a vector
+	    // ending with its last interval when it is
+	    // used to create the actual dispatcher.
     };
 
     extern min::packed_vec_insptr<dispatcher>
@@ -237,6 +250,11 @@ namespace ll { namespace lexeme
 	    // popped from the instruction stack when
 	    // an instruction containing an ELSE flag
 	    // is popped.
+	uns32 skip_to_length;
+	Uchar skip_to_vector
+	    [ll::lexeme::SKIP_TO_MAX_LENGTH];
+	    // SKIP_TO delimiter set, if ll::lexeme::
+	    // SKIP_TO is in operation.
 	bool accept;
 	    // True if and only if this is an accept
 	    // instruction.
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_program_data.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Wed Nov 15 05:19:17 EST 2017
+// Date:	Mon Oct 19 01:33:18 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -85,6 +85,23 @@ struct program_header {
 };
 const uns32 program_header_length = 5;
 
+// A program image file (see ll::lexeme::write_program_
+// image) is an image header followed by the length
+// uns32 elements of the program.  The version and
+// length, like the program, are in the endianhood of
+// the computer that wrote the file.  The version is
+// incremented whenever the program layout changes:
+// version 2 has two-level ctype maps.
+//
+struct image_header {
+    char magic[8];		// == IMAGE_MAGIC
+    uns32 version;		// == IMAGE_VERSION
+    uns32 length;
+};
+const char IMAGE_MAGIC[8] =
+    { 'L', 'L', 'L', 'E', 'X', 'P', 'R', 'G' };
+const uns32 IMAGE_VERSION = 2;
+
 // Returns max_master from program header.
 //
 inline min::uns32 max_master
@@ -290,6 +307,20 @@ const uns32 table_header_length = 5;
 // elements in the dispatcher, including the
 // ctype_map_size uns8 ctype elements at the end.
 //
+// If the TWO_LEVEL_MAP bit of ctype_map_size is set,
+// the ctype map is instead two level.  The remaining
+// bits of ctype_map_size are the map size, which is a
+// multiple of CTYPE_PAGE_SIZE, and the map is a vector
+// of map size / CTYPE_PAGE_SIZE uns32 ctype page IDs.
+// The ctype of cindex is element cindex % CTYPE_PAGE_
+// SIZE of the ctype page whose ID is element cindex /
+// CTYPE_PAGE_SIZE of this vector, or is 0 if that ID
+// is 0.  Ctype pages are separate program components
+// shared by all dispatchers whose maps contain the
+// same page.  Use map_ctype below to read either kind
+// of map.
+//
+const uns32 TWO_LEVEL_MAP = 0x80000000;
 struct dispatcher_header {
     uns32 pctype;		// == DISPATCHER
     uns32 line_number;
@@ -305,8 +336,79 @@ struct map_element {
 };
 const uns32 map_element_length = 3;
 
+// A ctype page is a header followed by CTYPE_PAGE_SIZE
+// uns8 ctypes.  Its component length is always ctype_
+// page_length.
+//
+const uns32 CTYPE_PAGE_SIZE = 256;
+struct ctype_page_header {
+    uns32 pctype;		// == CTYPE_PAGE
+    uns32 line_number;
+};
+const uns32 ctype_page_header_length = 2;
+const uns32 ctype_page_length =
+    ctype_page_header_length + CTYPE_PAGE_SIZE / 4;
+
+// Return the ID of the ctype map of a dispatcher.
+//
+inline uns32 ctype_map_ID_of
+	( uns32 ID, min::ptr<dispatcher_header> dhp )
+{
+    return   ID + dispatcher_header_length
+	   + ( dhp->max_ctype + 1 ) * map_element_length;
+}
+
+// Given a ctype_map_size, return the number of cindex
+// values mapped by the ctype map (cindex values not
+// less than this map to ctype 0), and the number of
+// uns32 elements the map occupies in its dispatcher.
+//
+inline uns32 ctype_map_limit ( uns32 ctype_map_size )
+{
+    return ctype_map_size & ~ TWO_LEVEL_MAP;
+}
+inline uns32 ctype_map_length ( uns32 ctype_map_size )
+{
+    if ( ctype_map_size & TWO_LEVEL_MAP )
+        return   ctype_map_limit ( ctype_map_size )
+	       / CTYPE_PAGE_SIZE;
+    else
+        return ( ctype_map_size + 3 ) / 4;
+}
+
+// Return the ctype of cindex given the ID and size of
+// a ctype map in a program.
+//
+inline uns32 map_ctype
+	( ll::lexeme::program program,
+	  uns32 ctype_map_ID,
+	  uns32 ctype_map_size,
+	  uns32 cindex )
+{
+    if ( ! ( ctype_map_size & TWO_LEVEL_MAP ) )
+        return cindex < ctype_map_size ?
+	       ll::lexeme::ptr<const uns8>
+	           ( program, ctype_map_ID )[cindex] :
+	       0;
+    else if (    cindex
+              >= ctype_map_limit ( ctype_map_size ) )
+        return 0;
+
+    uns32 page_ID =
+        program[  ctype_map_ID
+	        + cindex / CTYPE_PAGE_SIZE];
+    if ( page_ID == 0 ) return 0;
+    return ll::lexeme::ptr<const uns8>
+	       ( program,
+	         page_ID + ctype_page_header_length )
+	       [cindex % CTYPE_PAGE_SIZE];
+}
+
 // Instruction.  If operation includes TRANSLATE_TO(n)
 // this is followed by the n Uchars of the translation.
+// Then if operation includes SKIP_TO this is followed
+// by an uns32 count m and the m Uchars of the SKIP_TO
+// delimiter set.
 //
 struct instruction_header {
     uns32 pctype;	    // == INSTRUCTION
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_standard.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Sat Nov  4 03:33:14 EDT 2023
+// Date:	Mon Oct 19 13:24:50 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -306,7 +306,39 @@ namespace ll { namespace lexeme { namespace standard {
     //		ll::lexeme::default_program
     // and	ll::lexeme::standard::default_program
     //
-    void init_standard_program ( void );
+    // If compiled is not NULL the program is copied
+    // from that compiled program (see ll::lexeme::
+    // read_compiled_program), which is normally
+    // & compiled_default_program below.  Else if
+    // image_file is not NULL the program is read from
+    // that program image file (see ll::lexeme::read_
+    // program_image) if possible.  Otherwise the
+    // program is built as usual.  Lib/Makefile makes
+    // the image ll_lexeme_standard.llp of the program
+    // as optimized by ll::lexeme::optimize_program,
+    // which the compiled program does not match.
+    //
+    void init_standard_program
+	    ( const char * image_file = NULL,
+	      const ll::lexeme::compiled_program *
+	          compiled = NULL );
+
+    // Compiled code for ll::lexeme::standard::default_
+    // program; see ll::lexeme::init_compiled_program.
+    // Defined only in ll_lexeme_standard_compiled.o,
+    // which is not in liblayered.a; `make compiled' in
+    // lib makes it.
+    //
+    extern const ll::lexeme::compiled_program
+        compiled_default_program;
+
+    // Compiled program used by the standard parser
+    // input, or NULL (the default) to use none.  A
+    // program that links ll_lexeme_standard_compiled.o
+    // may set this to & compiled_default_program.
+    //
+    extern const ll::lexeme::compiled_program *
+        default_compiled_program;
 
 } } }
 
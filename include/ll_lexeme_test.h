@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_test.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Tue Jun  6 15:12:05 EDT 2017
+// Date:	Mon Oct 19 13:44:08 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -21,6 +21,7 @@
 
 # include <min.h>
 # include <iostream>
+# include <string>
 
 // Testers
 // -------
@@ -80,6 +81,25 @@ namespace ll { namespace lexeme {
     //
     void test_input ( uns32 end_of_file_t );
 
+    // Scan text from span input with rescan_lines,
+    // replace line edit_line by two new lines, rescan
+    // the edit, and print whether the lexemes and
+    // checkpoints are the same as for a full scan of
+    // the edited text, whether the lexemes outside
+    // the rescanned range are the old lexemes with
+    // their lines moved, and whether the rescan
+    // stopped before the end of file.  Erroneous
+    // atoms are not announced.
+    //
+    // The ll::lexeme::default_scanner is used and
+    // must have all its parameters preset except for
+    // input and erroneous_atom.  Its checkpoints are
+    // turned on.
+    //
+    void test_rescan
+	( const std::string & text, uns32 edit_line,
+	  uns32 end_of_file_t );
+
 } }
 
 # endif // LL_LEXEME_TEST_H
@@ -2,7 +2,7 @@
 //
 // File:	ll_parser.h
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Sat May 24 09:18:31 PM EDT 2025
+// Date:	Mon Oct 19 12:46:03 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -980,7 +980,10 @@ enum {
     TRACE_PARSER_INPUT			= 1ull << 1,
         // Trace flag with name `parser input' that
 	// traces each token input by the parser->input
-	// closure (e.g. from the lexical scanner).  
+	// closure (e.g. from the lexical scanner).  If
+	// parser->streaming, the parse function also
+	// prints the max_spooled_lines and max_live_
+	// tokens high-water marks when it ends.
 
     TRACE_PARSER_OUTPUT			= 1ull << 2,
         // Trace flag with the name `parser output' that
@@ -1205,6 +1208,22 @@ struct parser_struct
 	// even if it has not yet reached an end of
 	// file.  Default 100.
 
+    bool streaming;
+        // If true, the `parse' function releases
+	// spooled input_file lines before the first
+	// line still referenced by a token in the
+	// token list (other than the start of file
+	// token), by message_header, or by scanner
+	// input not yet scanned, each time it
+	// finishes a top level expression.  With an
+	// output closure that removes finished tokens,
+	// a parse of an arbitrarily long input then
+	// needs only bounded memory.  Lines recorded
+	// elsewhere, e.g., in the positions of parser
+	// definitions, may no longer be printable.
+	// The scanner input buffer is released as it
+	// is scanned regardless.  Default false.
+
     // Parser parameters saved/restored by block
     // begin/end, but not changed at the beginning
     // of the `parse' function.
@@ -1304,6 +1323,18 @@ struct parser_struct
         // Number of finished tokens at the beginning
 	// of the token list.  The `parse' function
 	// produces finished tokens and calls `output'.
+
+    uns32 spool_first_line;
+        // If streaming, line number of the first line
+	// not released.
+    uns32 max_spooled_lines;
+    uns32 max_live_tokens;
+        // If streaming, high-water marks of the
+	// number of spooled lines not released and the
+	// number of tokens in the token list, measured
+	// each time a top level expression is finished.
+	// Printed at the end of the parse if the
+	// TRACE_PARSER_INPUT flag is on.
 };
 
 inline min::uns32 block_level
@@ -1477,6 +1508,27 @@ void init_input_string
 	  const min::line_format * line_format = NULL,
 	  min::uns32 spool_lines = min::ALL_LINES );
 
+// Ditto but call ll::lexeme::init_input_mapped_file
+// for parser->scanner, and then set parser->input_file
+// to the scanner input_file, which is given the lines
+// of the mapped file as they are read.
+//
+bool init_input_mapped_file
+	( ll::parser::parser parser,
+	  min::gen file_name,
+	  const min::line_format * line_format = NULL,
+	  min::uns32 spool_lines = min::ALL_LINES );
+
+// Ditto but call ll::lexeme::init_input_read_ahead,
+// so the file is read by a background thread.  Defined
+// in ll_lexeme_read_ahead.cc along with that function.
+//
+bool init_input_read_ahead
+	( ll::parser::parser parser,
+	  min::gen file_name,
+	  const min::line_format * line_format = NULL,
+	  min::uns32 spool_lines = min::ALL_LINES );
+
 // The following initialize the parser and then call
 // the corresponding min::init_... function for
 // parser->printer.
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Fri May 23 03:00:50 PM EDT 2025
+// Date:	Mon Oct 19 01:44:08 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -13,10 +13,15 @@
 //	Usage and Setup
 //	Data
 //	Program Construction
+//	Program Optimization
+//	Program Images
 //	Scanner Closures
 //	Scanner
+//	Parallel Scanning
+//	Incremental Scanning
 //	Printing
 //	Printing Programs
+//	Compiled Programs
 //	Name String Scanning
 
 // Usage and Setup
@@ -26,10 +31,22 @@
 # include <min_os.h>
 # include <iostream>
 # include <iomanip>
+# include <fstream>
+# include <string>
+# include <vector>
+# include <map>
 # include <cstdlib>
 # include <cstring>
 # include <cstdio>
 # include <cerrno>
+# include <ctime>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <algorithm>
+# include <csignal>
+# include <sys/wait.h>
 # define LEX ll::lexeme
 # define LEXDATA ll::lexeme::program_data
 using std::cout;
@@ -67,6 +84,34 @@ static uns32 scanner_stub_disp[] =
                        ::erroneous_atom ),
       min::DISP ( & LEX::scanner_struct
                        ::printer ),
+      min::DISP ( & LEX::scanner_struct
+                       ::flat_states ),
+      min::DISP ( & LEX::scanner_struct
+                       ::flat_transitions ),
+      min::DISP ( & LEX::scanner_struct
+                       ::flat_ascii ),
+      min::DISP ( & LEX::scanner_struct
+                       ::profile ),
+      min::DISP ( & LEX::scanner_struct
+                       ::memo_table ),
+      min::DISP ( & LEX::scanner_struct
+                       ::memo_translations ),
+      min::DISP ( & LEX::scanner_struct
+                       ::input_chars ),
+      min::DISP ( & LEX::scanner_struct
+                       ::input_lines ),
+      min::DISP ( & LEX::scanner_struct
+                       ::input_offsets ),
+      min::DISP ( & LEX::scanner_struct
+                       ::input_bytes ),
+      min::DISP ( & LEX::scanner_struct
+                       ::line_bases ),
+      min::DISP ( & LEX::scanner_struct
+                       ::line_deltas ),
+      min::DISP ( & LEX::scanner_struct
+                       ::span_text ),
+      min::DISP ( & LEX::scanner_struct
+                       ::checkpoints ),
       min::DISP_END };
 
 static min::packed_struct<LEX::scanner_struct>
@@ -76,12 +121,34 @@ static min::packed_struct<LEX::scanner_struct>
 
 static min::packed_vec<char>
     char_vec_type ( "ll::lexeme::char_vec_type" );
+static min::packed_vec<LEX::uns8>
+    uns8_vec_type ( "ll::lexeme::uns8_vec_type" );
 static min::packed_vec<LEX::uns32>
     uns32_vec_type ( "ll::lexeme::uns32_vec_type" );
+static min::packed_vec<LEX::uns64>
+    uns64_vec_type ( "ll::lexeme::uns64_vec_type" );
 static min::packed_vec<LEX::Uchar>
     Uchar_vec_type ( "ll::lexeme::Uchar_vec_type" );
 static min::packed_vec<LEX::inchar>
     inchar_vec_type ( "ll::lexeme::inchar_vec_type" );
+static min::packed_vec<LEX::input_line>
+    input_line_vec_type
+	( "ll::lexeme::input_line_vec_type" );
+static min::packed_vec<LEX::flat_state>
+    flat_state_vec_type
+	( "ll::lexeme::flat_state_vec_type" );
+static min::packed_vec<LEX::flat_transition>
+    flat_transition_vec_type
+	( "ll::lexeme::flat_transition_vec_type" );
+static min::packed_vec<LEX::memo_entry>
+    memo_entry_vec_type
+	( "ll::lexeme::memo_entry_vec_type" );
+static min::packed_vec<LEX::parallel_lexeme>
+    parallel_lexeme_vec_type
+	( "ll::lexeme::parallel_lexeme_vec_type" );
+static min::packed_vec<LEX::checkpoint>
+    checkpoint_vec_type
+	( "ll::lexeme::checkpoint_vec_type" );
 static min::packed_struct<LEX::input_struct>
     input_type ( "ll::lexeme::input_type" );
 static min::packed_struct<LEX::erroneous_atom_struct>
@@ -92,6 +159,15 @@ min::locatable_var<LEX::program>
      LEX::default_program;
 min::locatable_var<LEX::input>
      LEX::default_input;
+static min::locatable_var<LEX::input>
+     mapped_input;
+     // Input closure for memory mapped files.
+static min::locatable_var<LEX::input>
+     span_input;
+     // Input closure for init_input_span.
+static min::locatable_var<LEX::erroneous_atom>
+     counting_erroneous_atom;
+     // Erroneous atom closure for scan_parallel.
 min::locatable_var<LEX::erroneous_atom>
      LEX::default_erroneous_atom;
 min::locatable_var<LEX::scanner>
@@ -288,6 +364,71 @@ void LEX::create_program
     php->component_length = length;
 }
 
+// Push the ctype pages of a two level ctype map that
+// are not already in the program onto the program,
+// and push the page ID of each page onto page_IDs.
+// The map is ctype_map[0 .. ctype_map_size-1] padded
+// with 0's to a whole number of pages.  All 0 pages
+// get page ID 0.
+//
+static void create_ctype_pages
+	( uns32 line_number,
+	  uns32 ctype_map_size,
+	  min::ptr<const uns8> ctype_map,
+	  std::vector<uns32> & page_IDs,
+	  LEX::program program )
+{
+    std::map<std::string, uns32> pages;
+    for ( uns32 ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] != CTYPE_PAGE ) continue;
+	pages[std::string
+	    ( (const char *)
+	      ~ & program[ID + ctype_page_header_length],
+	      CTYPE_PAGE_SIZE )] = ID;
+    }
+
+    const char * map = (const char *) ~ ctype_map;
+    for ( uns32 first = 0; first < ctype_map_size;
+          first += CTYPE_PAGE_SIZE )
+    {
+        std::string page
+	    ( map + first,
+	      first + CTYPE_PAGE_SIZE <= ctype_map_size ?
+	      CTYPE_PAGE_SIZE : ctype_map_size - first );
+	page.resize ( CTYPE_PAGE_SIZE, 0 );
+	if (    page.find_first_not_of ( (char) 0 )
+	     == std::string::npos )
+	{
+	    page_IDs.push_back ( 0 );
+	    continue;
+	}
+
+	std::map<std::string, uns32>::iterator it =
+	    pages.find ( page );
+	if ( it != pages.end() )
+	{
+	    page_IDs.push_back ( it->second );
+	    continue;
+	}
+
+	uns32 ID = program->length;
+	ctype_page_header h;
+	h.pctype = CTYPE_PAGE;
+	h.line_number = line_number;
+	PUSH ( h, ctype_page_header_length );
+	min::push
+	    ( program,   ctype_page_length
+	               - ctype_page_header_length );
+	memcpy ( ~ & program[  ID
+			     + ctype_page_header_length],
+		 page.data(), CTYPE_PAGE_SIZE );
+	pages[page] = ID;
+	page_IDs.push_back ( ID );
+    }
+}
+
 uns32 LEX::create_dispatcher
 	( uns32 line_number,
 	  uns32 max_ctype,
@@ -295,19 +436,29 @@ uns32 LEX::create_dispatcher
 	  min::ptr<const uns8> ctype_map,
 	  LEX::program program )
 {
+    std::vector<uns32> page_IDs;
+    bool two_level =
+        ( ctype_map_size > TWO_LEVEL_MAP_THRESHOLD );
+    if ( two_level )
+        ::create_ctype_pages
+	    ( line_number, ctype_map_size, ctype_map,
+	      page_IDs, program );
 
     uns32 ID = program->length;
     dispatcher_header h;
     h.pctype = DISPATCHER;
     h.line_number = line_number;
     h.max_ctype = max_ctype;
-    h.ctype_map_size = ctype_map_size;
+    h.ctype_map_size =
+        two_level ?
+	  ( page_IDs.size() * CTYPE_PAGE_SIZE )
+	| TWO_LEVEL_MAP :
+	ctype_map_size;
     h.component_length =
           dispatcher_header_length
 	+   map_element_length
 	  * ( max_ctype + 1 )
-	+   ( ctype_map_size + sizeof ( uns32 ) - 1 )
-	  / sizeof ( uns32 );
+	+ ctype_map_length ( h.ctype_map_size );
     PUSH ( h, dispatcher_header_length );
 
     MIN_REQUIRE (    sizeof ( map_element )
@@ -317,16 +468,61 @@ uns32 LEX::create_dispatcher
         ( program,   h.component_length
 	           - dispatcher_header_length );
 
-    if ( ctype_map_size != 0 )
-	memcpy ( ~ & program[  ID
-			     + dispatcher_header_length
-			     +   map_element_length
-			       * ( max_ctype + 1 )],
+    uns32 map_ID = ID + dispatcher_header_length
+		 +   map_element_length
+		   * ( max_ctype + 1 );
+    if ( two_level )
+	memcpy ( ~ & program[map_ID], & page_IDs[0],
+		 page_IDs.size() * sizeof ( uns32 ) );
+    else if ( ctype_map_size != 0 )
+	memcpy ( ~ & program[map_ID],
 		 ~ ctype_map, ctype_map_size );    
 
     return ID;
 }
 
+// Return the largest ctype in the ctype map of the
+// dispatcher at ID, or 0xFFFFFFFF if a page ID of a
+// two level map is not the ID of a ctype page.
+//
+static uns32 max_map_ctype
+	( LEX::program program, uns32 ID )
+{
+    min::ptr<dispatcher_header> dhp =
+	LEX::ptr<dispatcher_header> ( program, ID );
+    uns32 map_ID = ctype_map_ID_of ( ID, dhp );
+    uns32 max = 0;
+    if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+    {
+	uns32 n = ctype_map_length ( dhp->ctype_map_size );
+	for ( uns32 i = 0; i < n; ++ i )
+	{
+	    uns32 page_ID = program[map_ID + i];
+	    if ( page_ID == 0 ) continue;
+	    if (    page_ID + ctype_page_length
+	          > program->length
+		 || program[page_ID] != CTYPE_PAGE )
+	        return 0xFFFFFFFF;
+	    min::ptr<const uns8> page =
+		LEX::ptr<const uns8>
+		    ( program,
+		      page_ID + ctype_page_header_length );
+	    for ( uns32 j = 0; j < CTYPE_PAGE_SIZE; ++ j )
+		if ( page[j] > max ) max = page[j];
+	}
+    }
+    else
+    {
+	min::ptr<const uns8> ctype_map =
+	    LEX::ptr<const uns8> ( program, map_ID );
+	for ( uns32 cindex = 0;
+	      cindex < dhp->ctype_map_size; ++ cindex )
+	    if ( ctype_map[cindex] > max )
+	        max = ctype_map[cindex];
+    }
+    return max;
+}
+
 uns32 LEX::create_instruction
 	( uns32 line_number,
 	  uns32 operation,
@@ -338,6 +534,8 @@ uns32 LEX::create_instruction
 	  uns32 output_type,
 	  uns32 goto_table_ID,
 	  uns32 call_table_ID,
+	  uns32 skip_to_length,
+	  min::ptr<Uchar> skip_to_vector,
 	  LEX::program program )
 {
     MIN_ASSERT
@@ -501,6 +699,37 @@ uns32 LEX::create_instruction
 		     " non-zero and there is NO CALL"
 		     " operation" );
 
+    if ( operation & SKIP_TO )
+    {
+        MIN_ASSERT ( 0 < skip_to_length
+	             &&
+		        skip_to_length
+		     <= SKIP_TO_MAX_LENGTH,
+	             "skip_to_length argument is 0 or"
+		     " too large for SKIP_TO"
+		     " operation" );
+        MIN_ASSERT ( skip_to_vector != NULL_TV(),
+	             "skip_to_vector argument is NULL"
+		     " for SKIP_TO operation" );
+        MIN_ASSERT ( ( operation & (   MATCH
+	                             | TRANSLATE_HEX_FLAG
+	                             | TRANSLATE_OCT_FLAG
+	                             | TRANSLATE_NAME_FLAG
+	                             | REQUIRE ) )
+		     == 0,
+	             "operation argument has SKIP_TO"
+		     " and one of MATCH, TRANSLATE_HEX,"
+		     " TRANSLATE_OCT, TRANSLATE_NAME,"
+		     " or REQUIRE" );
+    }
+    else
+        MIN_ASSERT ( skip_to_length == 0
+	             &&
+		     skip_to_vector == NULL_TV(),
+	             "skip_to arguments are non-zero"
+		     " and there is NO SKIP_TO"
+		     " operation" );
+
     uns32 ID = program->length;
 
     instruction_header h;
@@ -520,6 +749,14 @@ uns32 LEX::create_instruction
 		translate_to_length,
                 translation_vector );
 
+    if ( operation & SKIP_TO )
+    {
+	min::push(program) = skip_to_length;
+	min::push ( program,
+		    skip_to_length,
+		    skip_to_vector );
+    }
+
     return ID;
 }
 
@@ -743,9 +980,18 @@ bool LEX::convert_program_endianhood
 		    ( program, cID );
 	    FOR(i,  map_element_length
 		  * ( dhp->max_ctype + 1 )) NEXT;
+	    if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+		FOR(i,ctype_map_length
+		          ( dhp->ctype_map_size )) NEXT;
 	    ID = cID + dhp->component_length;
 	    break;
 	}
+	case CTYPE_PAGE:
+	{
+	    FOR(i,ctype_page_header_length-1) NEXT;
+	    ID = cID + ctype_page_length;
+	    break;
+	}
 	case INSTRUCTION:
 	{
 	    FOR(i,instruction_header_length-1) NEXT;
@@ -758,6 +1004,11 @@ bool LEX::convert_program_endianhood
 		FOR(i,LEX::translate_to_length
 			    ( ihp->operation ))
 		    NEXT;
+	    if ( ihp->operation & LEX::SKIP_TO )
+	    {
+		uns32 skip_to_length = NEXT;
+		FOR(i,skip_to_length) NEXT;
+	    }
 	    break;
 	}
 	default:
@@ -777,146 +1028,1568 @@ bool LEX::convert_program_endianhood
 }
 
 # undef ERR
-
-// Scanner Closures
-// ------- --------
 
-static bool default_input_get
-	( LEX::scanner scanner,
-	  LEX::input input )
+# define VERR min::init ( min::error_message ) \
+    << "LEXICAL PROGRAM VERIFICATION ERROR: "
+
+// Work vectors for verify_program.  All vectors
+// indexed by table are indexed by the table index
+// assigned by verify_program, not by the table ID.
+//
+typedef min::packed_vec_insptr<uns32> uns32_vec;
+static min::locatable_var<uns32_vec> verify_mark;
+    // verify_mark[ID] is pctype + ( index << 8 ) if
+    // ID is the ID of a program component, where
+    // index is the table index for tables and 0
+    // otherwise.  verify_mark[ID] is 0 if ID is not
+    // a component ID.
+static min::locatable_var<uns32_vec> verify_stamp;
+    // verify_stamp[ID] is the table index + 1 of the
+    // last table whose components were collected by
+    // verify_edges.
+static min::locatable_var<uns32_vec> verify_tables;
+    // verify_tables[index] is the ID of the table.
+static min::locatable_var<uns32_vec> verify_first;
+    // verify_edges[verify_first[index] ..
+    //              verify_first[index+1]-1]
+    // are the edges of the table with the index.
+static min::locatable_var<uns32_vec> verify_edges;
+    // Edges are pairs: the index of a table that
+    // can be executed after the current table,
+    // and 1 if this pushes the return stack (CALL or
+    // MATCH) or 0 if not (GOTO).
+static min::locatable_var<uns32_vec> verify_work;
+    // Work stack.
+static min::locatable_var<uns32_vec> verify_low;
+static min::locatable_var<uns32_vec> verify_num;
+static min::locatable_var<uns32_vec> verify_scc;
+    // Per table index Tarjan algorithm lowlink,
+    // number, and strongly connected component + 1
+    // (0 if the table is on the work stack).
+static min::locatable_var<uns32_vec> verify_depth;
+    // Per strongly connected component maximum
+    // number of return stack pushes.
+
+// Set vector to n 0 elements, creating it if
+// necessary.
+//
+static void verify_clear
+	( min::locatable_var<uns32_vec> & vec,
+	  uns32 n )
 {
-    min::file file = scanner->input_file;
+    if ( vec == NULL_STUB )
+        vec = uns32_vec_type.new_gen();
+    min::pop ( vec, vec->length );
+    min::push ( vec, n );
+}
 
-    LEX::inchar ic;
-    ic.line = scanner->next_position.line;
-    ic.offset = scanner->next_position.offset;
-    ic.indent = scanner->next_indent;
-    MIN_REQUIRE (    ic.line
-                 == file->next_line_number );
+// Return true if ID is the ID of a program component
+// of the given pctype.
+//
+inline bool verify_is ( uns32 ID, uns32 pctype )
+{
+    return ID < verify_mark->length
+           &&
+	   ( verify_mark[ID] & 0xFF ) == pctype;
+}
 
-    min::uns32 offset = min::next_line ( file );
-    min::uns32 length;
-    bool add_eol = true;
+// Return true if ID is the ID of a program table
+// with the given mode.
+//
+inline bool verify_is_table
+	( LEX::program program, uns32 ID, uns32 mode )
+{
+    return verify_is ( ID, TABLE )
+           &&
+	   LEX::ptr<table_header> ( program, ID )->mode
+	   == mode;
+}
 
-    if ( offset == min::NO_LINE )
+// Check the component at program[ID] other than its
+// pctype and length.  Return true if OK, and false
+// after writing error message if not.
+//
+static bool verify_component
+	( LEX::program program, uns32 ID )
+{
+    switch ( program[ID] )
     {
-        length = min::remaining_length ( file );
-        if ( length == 0 ) return false;
-	offset = min::remaining_offset ( file );
-	min::skip_remaining ( file );
-	add_eol = false;
+    case PROGRAM:
+    {
+	min::ptr<program_header> php =
+	    LEX::ptr<program_header> ( program, ID );
+	for ( uns32 m = 0; m <= php->max_master; ++ m )
+	{
+	    uns32 tID =
+	        program[ID + program_header_length + m];
+	    if ( tID != 0
+	         &&
+		 ! verify_is_table
+		       ( program, tID, MASTER ) )
+	    {
+		VERR << "master table " << m
+		     << " is not a MASTER table"
+		     << min::eol;
+		return false;
+	    }
+	}
+	return true;
     }
-    else
-        length = ::strlen ( ~ & file->buffer[offset] );
-
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
-
-    while ( length != 0 )
+    case TABLE:
     {
-	const char * beginp = ~ & file->buffer[offset];
-	const char * endp = beginp + length;
-	const char * p = beginp;
-	Uchar unicode =
-	    min::utf8_to_unicode ( p, endp );
-	uns32 bytes_read = p - beginp;
-	MIN_REQUIRE ( length >= bytes_read );
-	offset += bytes_read;
-	length -= bytes_read;
-
-	ic.character = unicode;
-	min::push(input_buffer) = ic;
-
-	ic.offset += bytes_read;
-	if ( ic.indent != AFTER_GRAPHIC )
+	min::ptr<table_header> thp =
+	    LEX::ptr<table_header> ( program, ID );
+	if ( thp->dispatcher_ID != 0
+	     &&
+	     ! verify_is ( thp->dispatcher_ID,
+	                   DISPATCHER ) )
 	{
-	    min::uns16 i = min::Uindex ( unicode );
-	    if ( i >= min::unicode::index_limit )
-	        ic.indent = AFTER_GRAPHIC;
-	    else
+	    VERR << "dispatcher ID of table "
+	         << pID ( ID, program )
+		 << " is not a dispatcher"
+		 << min::eol;
+	    return false;
+	}
+	if ( thp->instruction_ID != 0
+	     &&
+	     ! verify_is ( thp->instruction_ID,
+	                   INSTRUCTION ) )
+	{
+	    VERR << "instruction ID of table "
+	         << pID ( ID, program )
+		 << " is not an instruction"
+		 << min::eol;
+	    return false;
+	}
+	return true;
+    }
+    case DISPATCHER:
+    {
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	uns32 ctype_map_ID = ctype_map_ID_of ( ID, dhp );
+	if (   ctype_map_ID
+	     + ctype_map_length ( dhp->ctype_map_size )
+	     > ID + dhp->component_length
+	     ||
+	     (    ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	       &&
+	          ctype_map_limit ( dhp->ctype_map_size )
+		% CTYPE_PAGE_SIZE != 0 ) )
+	{
+	    VERR << "ctype map of dispatcher "
+	         << pID ( ID, program )
+		 << " is too long" << min::eol;
+	    return false;
+	}
+	min::ptr<map_element> mep =
+	    LEX::ptr<map_element>
+		( program, ID + dispatcher_header_length );
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	{
+	    uns32 dID = (&mep[t])->dispatcher_ID;
+	    uns32 iID = (&mep[t])->instruction_ID;
+	    if ( ( dID != 0
+	           &&
+		   ! verify_is ( dID, DISPATCHER ) )
+		 ||
+		 ( iID != 0
+		   &&
+		   ! verify_is ( iID, INSTRUCTION ) ) )
 	    {
-		// We use min::standard_flags to find
-		// out if `unicode' is in a graphic
-		// category (L, M, P, or S) or in
-		// category Zs.
-		//
-	        min::uns32 flags =
-		    min::standard_char_flags[i];
-		if ( flags & min::IS_GRAPHIC )
-		    ic.indent = AFTER_GRAPHIC;
-		else if ( unicode == '\t' )
-	            ic.indent += 8 - ic.indent % 8;
-		else if ( flags & min::IS_HSPACE )
-	            ++ ic.indent;
+		VERR << "ctype " << t
+		     << " of dispatcher "
+		     << pID ( ID, program )
+		     << " maps to an illegal component"
+		     << min::eol;
+		return false;
+	    }
+	}
+	if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	{
+	    uns32 n =
+	        ctype_map_length ( dhp->ctype_map_size );
+	    for ( uns32 i = 0; i < n; ++ i )
+	    {
+		uns32 page_ID = program[ctype_map_ID + i];
+		if ( page_ID != 0
+		     &&
+		     ! verify_is ( page_ID, CTYPE_PAGE ) )
+		{
+		    VERR << "ctype map of dispatcher "
+			 << pID ( ID, program )
+			 << " has illegal page ID "
+			 << page_ID << min::eol;
+		    return false;
+		}
 	    }
 	}
+	uns32 max = ::max_map_ctype ( program, ID );
+	if ( max > dhp->max_ctype )
+	{
+	    VERR << "ctype map of dispatcher "
+		 << pID ( ID, program )
+		 << " has ctype " << max
+		 << " > max_ctype" << min::eol;
+	    return false;
+	}
+	return true;
     }
-
-    if ( add_eol )
+    case CTYPE_PAGE:
+	return true;
+    case INSTRUCTION:
     {
-	ic.character = '\n';
-	min::push(input_buffer) = ic;
-	++ ic.line;
-	ic.offset = 0;
-	ic.indent = 0;
+	min::ptr<instruction_header> ihp =
+	    LEX::ptr<instruction_header> ( program, ID );
+	uns32 op = ihp->operation;
+	const char * error = NULL;
+	if ( ( op & MATCH )
+	     &&
+	     ! verify_is_table
+	           ( program, ihp->atom_table_ID, ATOM ) )
+	    error = "MATCH target is not an atom table";
+	else if ( ( op & REQUIRE )
+		  &&
+		  ! verify_is
+		        ( ihp->require_dispatcher_ID,
+			  DISPATCHER ) )
+	    error = "REQUIRE target is not a"
+	            " dispatcher";
+	else if ( ( op & ELSE )
+		  &&
+		  ! verify_is
+		        ( ihp->else_instruction_ID,
+			  INSTRUCTION ) )
+	    error = "ELSE target is not an instruction";
+	else if ( ( op & GOTO )
+		  &&
+		  (    ! verify_is
+		             ( ihp->goto_table_ID, TABLE )
+		    || verify_is_table
+		           ( program, ihp->goto_table_ID,
+			     ATOM ) ) )
+	    error = "GOTO target is not a non-atom"
+	            " table";
+	else if ( ( op & CALL )
+		  &&
+		  (    ! verify_is
+		             ( ihp->call_table_ID, TABLE )
+		    || verify_is_table
+		           ( program, ihp->call_table_ID,
+			     ATOM )
+		    || verify_is_table
+		           ( program, ihp->call_table_ID,
+			     MASTER ) ) )
+	    error = "CALL target is not a (sub)lexeme"
+	            " table";
+	else if ( op & SKIP_TO )
+	{
+	    uns32 n = program
+	        [  ID + instruction_header_length
+		 + ( op & TRANSLATE_TO_FLAG ?
+		     LEX::translate_to_length ( op ) :
+		     0 )];
+	    if ( op & (   MATCH
+	                | TRANSLATE_HEX_FLAG
+	                | TRANSLATE_OCT_FLAG
+	                | TRANSLATE_NAME_FLAG
+	                | REQUIRE ) )
+		error = "SKIP_TO combined with MATCH,"
+		        " TRANSLATE_..., or REQUIRE";
+	    else if ( n == 0 || n > SKIP_TO_MAX_LENGTH )
+		error = "SKIP_TO delimiter count is 0"
+		        " or too large";
+	}
+	if ( error != NULL )
+	{
+	    VERR << "in instruction "
+	         << pID ( ID, program ) << ": "
+		 << error << min::eol;
+	    return false;
+	}
+	return true;
+    }
+    default:
+        MIN_ABORT ( "bad pctype" );
     }
-
-    scanner->next_position = (min::position) ic;
-    scanner->next_indent = ic.indent;
-
-    return true;
 }
 
-static void default_erroneous_atom_announce
-	( uns32 first, uns32 next, uns32 type,
-	  LEX::scanner scanner,
-	  LEX::erroneous_atom erroneous_atom )
+// Add the edges of the table with the given index to
+// verify_edges, by collecting all the instructions
+// that can be executed by the table.
+//
+static void verify_add_edges
+	( LEX::program program, uns32 index )
 {
-    if ( scanner->printer == min::NULL_STUB )
-        min::init ( LEX::printer_ref(scanner) );
-
-    ++ erroneous_atom->count;
+    uns32 tID = verify_tables[index];
+    min::ptr<table_header> thp =
+	LEX::ptr<table_header> ( program, tID );
+    bool is_atom = ( thp->mode == ATOM );
 
-    scanner->printer
-        << "ERRONEOUS ATOM: ";
+    min::pop ( verify_work, verify_work->length );
+    if ( thp->dispatcher_ID != 0 )
+        min::push(verify_work) = thp->dispatcher_ID;
+    if ( thp->instruction_ID != 0 )
+        min::push(verify_work) = thp->instruction_ID;
 
-    if ( erroneous_atom->mode == LEX::BASIC )
+    while ( verify_work->length > 0 )
     {
-        scanner->printer
-	    << LEX::perroneous_atom
-	           ( scanner, first, next, type )
-	    << min::eol;
-	return;
-    }
-
-    scanner->printer
-        << LEX::pmode ( scanner->program, type );
+        uns32 ID = verify_work[verify_work->length-1];
+	min::pop ( verify_work );
+	if ( verify_stamp[ID] == index + 1 ) continue;
+	verify_stamp[ID] = index + 1;
 
-    switch ( erroneous_atom->mode )
-    {
-    case NORMAL:
-	scanner->printer
-	    << " " << LEX::pline_numbers
-	                  ( scanner, first, next );
+	if ( program[ID] == DISPATCHER )
+	{
+	    min::ptr<dispatcher_header> dhp =
+		LEX::ptr<dispatcher_header>
+		    ( program, ID );
+	    min::ptr<map_element> mep =
+		LEX::ptr<map_element>
+		    ( program,
+		      ID + dispatcher_header_length );
+	    for ( uns32 t = 0; t <= dhp->max_ctype;
+	                       ++ t )
+	    {
+		if ( (&mep[t])->dispatcher_ID != 0 )
+		    min::push(verify_work) =
+			(&mep[t])->dispatcher_ID;
+		if ( (&mep[t])->instruction_ID != 0 )
+		    min::push(verify_work) =
+			(&mep[t])->instruction_ID;
+	    }
+	    continue;
+	}
 
-	// Falls through.
-    case NO_LINE_NUMBERS:
-	scanner->printer << ":" << min::eol;
+	min::ptr<instruction_header> ihp =
+	    LEX::ptr<instruction_header>
+		( program, ID );
+	uns32 op = ihp->operation;
+	if ( op & ELSE )
+	    min::push(verify_work) =
+	        ihp->else_instruction_ID;
+	if ( op & MATCH )
+	{
+	    min::push(verify_edges) =
+	        verify_mark[ihp->atom_table_ID] >> 8;
+	    min::push(verify_edges) = 1;
+	}
 
-	LEX::print_phrase_lines
-	    ( scanner->printer, scanner, first, next );
-	break;
+	// Atom table instructions are executed only by
+	// MATCH, which ignores GOTO and CALL.
+	//
+	if ( is_atom ) continue;
 
-    default:
-        MIN_ABORT
-	    ( "Bad erroneous atom announce mode" );
+	if ( op & GOTO )
+	{
+	    min::push(verify_edges) =
+	        verify_mark[ihp->goto_table_ID] >> 8;
+	    min::push(verify_edges) = 0;
+	}
+	if ( op & CALL )
+	{
+	    min::push(verify_edges) =
+	        verify_mark[ihp->call_table_ID] >> 8;
+	    min::push(verify_edges) = 1;
+	}
     }
 }
 
-void LEX::init
-	( min::ref<LEX::input> input,
-	  bool (*get) ( LEX::scanner scanner,
-			LEX::input input ) )
+// Tarjan's strongly connected components algorithm
+// applied to tables and their edges.  When a
+// component is found, the maximum number of return
+// stack pushes that can be made starting from it is
+// computed, and if an edge inside the component
+// pushes the return stack (so CALL or MATCH can be
+// recursive), an error is written to min::error_
+// message and verify_ok is set false.
+//
+static uns32 verify_counter;
+static uns32 verify_scc_count;
+static bool verify_ok;
+static void verify_components
+	( LEX::program program, uns32 index )
+{
+    verify_num[index] = ++ verify_counter;
+    verify_low[index] = verify_counter;
+    uns32 work_p = verify_work->length;
+    min::push(verify_work) = index;
+
+    for ( uns32 e = verify_first[index];
+          e < verify_first[index+1]; e += 2 )
+    {
+        uns32 j = verify_edges[e];
+	if ( verify_num[j] == 0 )
+	{
+	    ::verify_components ( program, j );
+	    if ( verify_low[j] < verify_low[index] )
+	        verify_low[index] = verify_low[j];
+	}
+	else if ( verify_scc[j] == 0
+	          &&
+		  verify_num[j] < verify_low[index] )
+	    verify_low[index] = verify_num[j];
+    }
+
+    if ( verify_low[index] != verify_num[index] )
+        return;
+
+    uns32 scc = ++ verify_scc_count;
+    for ( uns32 p = work_p; p < verify_work->length;
+                            ++ p )
+        verify_scc[verify_work[p]] = scc;
+
+    uns32 depth = 0;
+    for ( uns32 p = work_p; p < verify_work->length;
+                            ++ p )
+    {
+        uns32 i = verify_work[p];
+	for ( uns32 e = verify_first[i];
+	      e < verify_first[i+1]; e += 2 )
+	{
+	    uns32 j = verify_edges[e];
+	    uns32 push = verify_edges[e+1];
+	    if ( verify_scc[j] != scc )
+	    {
+	        uns32 d = push + verify_depth
+		                     [verify_scc[j]];
+		if ( d > depth ) depth = d;
+	    }
+	    else if ( push && verify_ok )
+	    {
+		VERR << "table "
+		     << pID ( verify_tables[i], program )
+		     << " can CALL or MATCH itself"
+		        " recursively" << min::eol;
+		verify_ok = false;
+	    }
+	}
+    }
+    min::push(verify_depth) = depth;
+    min::pop ( verify_work,
+               verify_work->length - work_p );
+}
+
+bool LEX::verify_program ( LEX::program program )
+{
+    if ( program->length < program_header_length
+         ||
+	 program[0] != PROGRAM )
+    {
+	VERR << "program does not begin with a"
+	        " program header" << min::eol;
+	return false;
+    }
+
+    ::verify_clear ( verify_mark, program->length );
+    ::verify_clear ( verify_tables, 0 );
+
+    // Mark component IDs and check component types
+    // and lengths.
+    //
+    uns32 ID = 0;
+    while ( ID < program->length )
+    {
+        uns32 pctype = program[ID];
+	uns32 length =
+	    LEX::component_length ( ID, program );
+	if ( pctype < PROGRAM || pctype > CTYPE_PAGE
+	     ||
+	     length == 0
+	     ||
+	     ID + length > program->length )
+	{
+	    VERR << "illegal program component at"
+	            " offset " << ID
+		 << " in the program vector of uns32"
+		    " elements" << min::eol;
+	    return false;
+	}
+	if ( pctype == TABLE )
+	{
+	    verify_mark[ID] =
+	        pctype + ( verify_tables->length << 8 );
+	    min::push(verify_tables) = ID;
+	}
+	else
+	    verify_mark[ID] = pctype;
+	ID += length;
+    }
+
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( ! ::verify_component ( program, ID ) )
+	    return false;
+    }
+
+    // Compute the return stack depth bound.
+    //
+    uns32 ntables = verify_tables->length;
+    ::verify_clear ( verify_stamp, program->length );
+    ::verify_clear ( verify_first, 0 );
+    ::verify_clear ( verify_edges, 0 );
+    ::verify_clear ( verify_work, 0 );
+    for ( uns32 i = 0; i < ntables; ++ i )
+    {
+        min::push(verify_first) = verify_edges->length;
+	::verify_add_edges ( program, i );
+    }
+    min::push(verify_first) = verify_edges->length;
+
+    ::verify_clear ( verify_low, ntables );
+    ::verify_clear ( verify_num, ntables );
+    ::verify_clear ( verify_scc, ntables );
+    ::verify_clear ( verify_depth, 1 );
+    ::verify_clear ( verify_work, 0 );
+    verify_counter = 0;
+    verify_scc_count = 0;
+    verify_ok = true;
+    uns32 depth = 0;
+    for ( uns32 i = 0; i < ntables; ++ i )
+    {
+        if ( verify_num[i] == 0 )
+	    ::verify_components ( program, i );
+	if ( ! verify_ok ) return false;
+	if ( verify_depth[verify_scc[i]] > depth )
+	    depth = verify_depth[verify_scc[i]];
+    }
+    if ( depth > LEX::return_stack_size )
+    {
+	VERR << "CALLs and MATCHes can be nested "
+	     << depth << " deep, which is more than"
+	        " the return stack size "
+	     << LEX::return_stack_size << min::eol;
+	return false;
+    }
+
+    return true;
+}
+
+# undef VERR
+
+// Program Optimization
+// ------- ------------
+
+const uns32 NO_CTYPE = 0xFFFFFFFF;
+    // Ctype dropped by optimize_ctypes.
+static uns32 optimize_ctypes
+	( LEX::program program, uns32 ID,
+	  std::vector<uns32> & ctypes,
+	  uns32 & map_size );
+
+// Push onto refs the IDs of the components referenced
+// by the component at ID.  Map elements of dispatcher
+// ctypes that the ctype map does not use are ignored.
+//
+static void component_references
+	( LEX::program program, uns32 ID,
+	  std::vector<uns32> & refs )
+{
+    switch ( program[ID] )
+    {
+    case TABLE:
+    {
+	min::ptr<table_header> thp =
+	    LEX::ptr<table_header> ( program, ID );
+	refs.push_back ( thp->dispatcher_ID );
+	refs.push_back ( thp->instruction_ID );
+	break;
+    }
+    case DISPATCHER:
+    {
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	min::ptr<map_element> mep =
+	    LEX::ptr<map_element>
+		( program, ID + dispatcher_header_length );
+	std::vector<uns32> ctypes;
+	uns32 map_size;
+	::optimize_ctypes ( program, ID, ctypes, map_size );
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	{
+	    if ( ctypes[t] == NO_CTYPE ) continue;
+	    refs.push_back ( (&mep[t])->dispatcher_ID );
+	    refs.push_back ( (&mep[t])->instruction_ID );
+	}
+	if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	{
+	    uns32 map_ID = ctype_map_ID_of ( ID, dhp );
+	    uns32 n =
+	        ctype_map_length ( dhp->ctype_map_size );
+	    for ( uns32 i = 0; i < n; ++ i )
+		refs.push_back ( program[map_ID + i] );
+	}
+	break;
+    }
+    case INSTRUCTION:
+    {
+	min::ptr<instruction_header> ihp =
+	    LEX::ptr<instruction_header> ( program, ID );
+	refs.push_back ( ihp->atom_table_ID );
+	refs.push_back ( ihp->require_dispatcher_ID );
+	refs.push_back ( ihp->else_instruction_ID );
+	refs.push_back ( ihp->goto_table_ID );
+	refs.push_back ( ihp->call_table_ID );
+	break;
+    }
+    }
+}
+
+// Compute the dense renumbering of the ctypes of the
+// dispatcher at ID: ctypes[t] is the new ctype of old
+// ctype t, or NO_CTYPE if t does not appear in the
+// ctype map (ctype 0 is always kept).  Set map_size
+// to the ctype map size with trailing elements whose
+// new ctype is 0 dropped.  Return the number of new
+// ctypes.  The ctypes of a two level map are left
+// as is, since its pages may be shared.
+//
+static uns32 optimize_ctypes
+	( LEX::program program, uns32 ID,
+	  std::vector<uns32> & ctypes,
+	  uns32 & map_size )
+{
+    min::ptr<dispatcher_header> dhp =
+	LEX::ptr<dispatcher_header> ( program, ID );
+    if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+    {
+	ctypes.resize ( dhp->max_ctype + 1 );
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	    ctypes[t] = t;
+	map_size = dhp->ctype_map_size;
+	return dhp->max_ctype + 1;
+    }
+
+    min::ptr<const uns8> ctype_map =
+	LEX::ptr<const uns8>
+	    ( program,
+		ID + dispatcher_header_length
+	      +   ( dhp->max_ctype + 1 )
+		* map_element_length );
+
+    ctypes.assign ( dhp->max_ctype + 1, NO_CTYPE );
+    ctypes[0] = 0;
+    for ( uns32 c = 0; c < dhp->ctype_map_size; ++ c )
+	ctypes[ctype_map[c]] = 0;
+    uns32 n = 0;
+    for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	if ( ctypes[t] != NO_CTYPE ) ctypes[t] = n ++;
+
+    map_size = dhp->ctype_map_size;
+    while ( map_size > 0
+            &&
+	    ctypes[ctype_map[map_size - 1]] == 0 )
+	-- map_size;
+    return n;
+}
+
+// Append the optimized form of the component at ID
+// to out, replacing each non-zero component ID r it
+// references by id_map[r].  If line_numbers is false,
+// the line number is set to 0, so the result can be
+// compared with that of another component.
+//
+static void optimized_component
+	( LEX::program program, uns32 ID,
+	  const std::vector<uns32> & id_map,
+	  bool line_numbers,
+	  std::vector<uns32> & out )
+{
+    uns32 first = out.size();
+
+    if ( program[ID] == DISPATCHER )
+    {
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	min::ptr<map_element> mep =
+	    LEX::ptr<map_element>
+		( program, ID + dispatcher_header_length );
+	min::ptr<const uns8> ctype_map =
+	    LEX::ptr<const uns8>
+		( program,
+		    ID + dispatcher_header_length
+		  +   ( dhp->max_ctype + 1 )
+		    * map_element_length );
+
+	std::vector<uns32> ctypes;
+	uns32 map_size;
+	uns32 n = ::optimize_ctypes
+	    ( program, ID, ctypes, map_size );
+
+	out.push_back ( DISPATCHER );
+	out.push_back ( dhp->line_number );
+	out.push_back ( n - 1 );
+	out.push_back ( map_size );
+	out.push_back
+	    (   dispatcher_header_length
+	      + n * map_element_length
+	      + ctype_map_length ( map_size ) );
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	{
+	    if ( ctypes[t] == NO_CTYPE ) continue;
+	    out.push_back
+	        ( id_map[(&mep[t])->dispatcher_ID] );
+	    out.push_back
+	        ( id_map[(&mep[t])->instruction_ID] );
+	    out.push_back ( (&mep[t])->repeat_count );
+	}
+	if ( map_size & TWO_LEVEL_MAP )
+	{
+	    uns32 map_ID = ctype_map_ID_of ( ID, dhp );
+	    uns32 pages = ctype_map_length ( map_size );
+	    for ( uns32 i = 0; i < pages; ++ i )
+		out.push_back
+		    ( id_map[program[map_ID + i]] );
+	}
+	else
+	{
+	    uns32 map_first = out.size();
+	    out.resize
+	        ( map_first + ( map_size + 3 ) / 4, 0 );
+	    uns8 * mp = (uns8 *) & out[map_first];
+	    for ( uns32 c = 0; c < map_size; ++ c )
+		mp[c] = ctypes[ctype_map[c]];
+	}
+    }
+    else
+    {
+	uns32 length = LEX::component_length
+	    ( ID, program );
+	for ( uns32 i = 0; i < length; ++ i )
+	    out.push_back ( program[ID + i] );
+
+	if ( program[ID] == TABLE )
+	{
+	    table_header * thp =
+	        (table_header *) & out[first];
+	    thp->dispatcher_ID =
+	        id_map[thp->dispatcher_ID];
+	    thp->instruction_ID =
+	        id_map[thp->instruction_ID];
+	}
+	else if ( program[ID] == INSTRUCTION )
+	{
+	    instruction_header * ihp =
+	        (instruction_header *) & out[first];
+	    ihp->atom_table_ID =
+	        id_map[ihp->atom_table_ID];
+	    ihp->require_dispatcher_ID =
+	        id_map[ihp->require_dispatcher_ID];
+	    ihp->else_instruction_ID =
+	        id_map[ihp->else_instruction_ID];
+	    ihp->goto_table_ID =
+	        id_map[ihp->goto_table_ID];
+	    ihp->call_table_ID =
+	        id_map[ihp->call_table_ID];
+	}
+    }
+
+    if ( ! line_numbers ) out[first + 1] = 0;
+}
+
+bool LEX::optimize_program
+	( LEX::program program,
+	  min::printer printer )
+{
+    if ( ! LEX::verify_program ( program ) )
+        return false;
+
+    uns32 length = program->length;
+    min::ptr<program_header> php =
+	LEX::ptr<program_header> ( program, 0 );
+    uns32 header_length = php->component_length;
+    uns32 max_master = php->max_master;
+
+    // Components other than the program header, in
+    // program order.
+    //
+    std::vector<uns32> components;
+    for ( uns32 ID = header_length; ID < length;
+          ID += LEX::component_length ( ID, program ) )
+        components.push_back ( ID );
+
+    // Mark the components reachable from the tables.
+    //
+    std::vector<bool> reachable ( length, false );
+    std::vector<uns32> work, refs;
+    for ( uns32 i = 0; i < components.size(); ++ i )
+    {
+        uns32 ID = components[i];
+	if ( program[ID] != TABLE ) continue;
+	reachable[ID] = true;
+	work.push_back ( ID );
+    }
+    while ( ! work.empty() )
+    {
+        uns32 ID = work.back();
+	work.pop_back();
+	refs.clear();
+	::component_references ( program, ID, refs );
+	for ( uns32 i = 0; i < refs.size(); ++ i )
+	{
+	    uns32 r = refs[i];
+	    if ( r == 0 || reachable[r] ) continue;
+	    reachable[r] = true;
+	    work.push_back ( r );
+	}
+    }
+
+    // rep[ID] is the earliest component identical to
+    // ID.  Merging components can make components that
+    // reference them identical, so repeat until there
+    // are no new merges.  Tables are never merged.
+    //
+    std::vector<uns32> rep ( length, 0 );
+    for ( uns32 i = 0; i < components.size(); ++ i )
+        rep[components[i]] = components[i];
+    while ( true )
+    {
+	std::map< std::vector<uns32>, uns32 > forms;
+	std::vector<uns32> next_rep ( rep );
+	for ( uns32 i = 0; i < components.size(); ++ i )
+	{
+	    uns32 ID = components[i];
+	    if ( ! reachable[ID] || program[ID] == TABLE )
+	        continue;
+	    std::vector<uns32> form;
+	    ::optimized_component
+	        ( program, ID, rep, false, form );
+	    next_rep[ID] =
+	        forms.insert ( std::make_pair ( form, ID ) )
+		    .first->second;
+	}
+	if ( next_rep == rep ) break;
+	rep.swap ( next_rep );
+    }
+
+    // Assign new IDs and build the new program.
+    //
+    std::vector<uns32> new_ID ( length, 0 );
+    std::vector<uns32> out;
+    uns32 next = header_length;
+    uns32 dropped = 0, merged = 0;
+    for ( uns32 i = 0; i < components.size(); ++ i )
+    {
+	uns32 ID = components[i];
+	if ( ! reachable[ID] ) ++ dropped;
+	else if ( rep[ID] != ID )
+	{
+	    new_ID[ID] = new_ID[rep[ID]];
+	    ++ merged;
+	}
+	else
+	{
+	    new_ID[ID] = next;
+	    out.clear();
+	    ::optimized_component
+	        ( program, ID, rep, true, out );
+	    next += out.size();
+	}
+    }
+
+    out.clear();
+    for ( uns32 i = 0; i < header_length; ++ i )
+        out.push_back ( program[i] );
+    for ( uns32 m = 0; m <= max_master; ++ m )
+    {
+        uns32 & ID = out[program_header_length + m];
+	ID = new_ID[ID];
+    }
+    for ( uns32 i = 0; i < components.size(); ++ i )
+    {
+	uns32 ID = components[i];
+	if ( reachable[ID] && rep[ID] == ID )
+	    ::optimized_component
+		( program, ID, new_ID, true, out );
+    }
+    MIN_REQUIRE ( out.size() == next );
+
+    min::pop ( program, length );
+    min::push ( program, out.size(),
+                min::new_ptr<const uns32> ( & out[0] ) );
+
+    if ( printer != min::NULL_STUB )
+	printer << "OPTIMIZED PROGRAM: "
+	        << length << " -> " << program->length
+		<< " uns32 elements, " << dropped
+		<< " unreachable and " << merged
+		<< " duplicate components removed"
+		<< min::eol;
+    return true;
+}
+
+// Program Images
+// ------- ------
+
+bool LEX::write_program_image
+	( const char * file_name,
+	  LEX::program program )
+{
+    image_header h;
+    memcpy ( h.magic, IMAGE_MAGIC, sizeof ( h.magic ) );
+    h.version = IMAGE_VERSION;
+    h.length = program->length;
+
+    std::ofstream out
+        ( file_name,
+	  std::ios::out | std::ios::binary
+	                | std::ios::trunc );
+    out.write ( (const char *) & h, sizeof ( h ) );
+    out.write ( (const char *)
+                ~ min::begin_ptr_of ( program ),
+		h.length * sizeof ( uns32 ) );
+    out.close();
+    if ( ! out )
+    {
+	min::init ( min::error_message )
+	    << "ERROR: cannot write program image file "
+	    << file_name << min::eol;
+        return false;
+    }
+    return true;
+}
+
+// Return v with its bytes reversed.
+//
+inline uns32 swap_bytes ( uns32 v )
+{
+    return   ( v >> 24 )
+           | ( ( v >> 8 ) & 0xFF00 )
+           | ( ( v << 8 ) & 0xFF0000 )
+	   | ( v << 24 );
+}
+
+bool LEX::read_program_image
+	( const char * file_name,
+	  min::ref<LEX::program> program_arg )
+{
+    int fd = ::open ( file_name, O_RDONLY );
+    struct stat st;
+    void * data = MAP_FAILED;
+    if ( fd >= 0 && ::fstat ( fd, & st ) == 0
+                 && st.st_size > 0 )
+	data = ::mmap ( NULL, st.st_size, PROT_READ,
+			MAP_PRIVATE, fd, 0 );
+    int saved_errno = errno;
+    if ( fd >= 0 ) ::close ( fd );
+    if ( data == MAP_FAILED )
+    {
+	min::init ( min::error_message )
+	    << "ERROR: cannot map program image file "
+	    << file_name << ": "
+	    << ::strerror ( saved_errno )
+	    << min::eol;
+        return false;
+    }
+
+    const image_header * hp =
+        (const image_header *) data;
+    uns32 version = 0, length = 0;
+    bool ok =
+	(    (uns64) st.st_size
+	  >= sizeof ( image_header ) )
+	&&
+	memcmp ( hp->magic, IMAGE_MAGIC,
+	         sizeof ( hp->magic ) ) == 0;
+    if ( ok )
+    {
+	version = hp->version;
+	length = hp->length;
+	if ( version != IMAGE_VERSION )
+	{
+	    version = ::swap_bytes ( version );
+	    length = ::swap_bytes ( length );
+	}
+	ok = ( version == IMAGE_VERSION
+	       &&
+	          (uns64) st.st_size
+	       ==   sizeof ( image_header )
+	          + (uns64) length * sizeof ( uns32 ) );
+    }
+
+    if ( ok )
+    {
+	if ( program_arg == NULL_STUB )
+	    program_arg = uns32_vec_type.new_gen();
+	LEX::program program = program_arg;
+	min::pop ( program, program->length );
+	min::push
+	    ( program, length,
+	      min::new_ptr
+	          ( (const uns32 *) ( hp + 1 ) ) );
+    }
+    ::munmap ( data, st.st_size );
+
+    if ( ! ok )
+    {
+	min::init ( min::error_message )
+	    << "ERROR: " << file_name
+	    << " is not a version " << IMAGE_VERSION
+	    << " lexical program image file"
+	    << min::eol;
+        return false;
+    }
+    return LEX::convert_program_endianhood
+               ( program_arg );
+}
+
+// Scanner Closures
+// ------- --------
+
+// Return the number of bytes at the beginning of
+// p .. endp that are ASCII (< 0x80).  Bytes are
+// tested 8 at a time using a 64 bit word whose
+// high order byte bits must all be zero.
+//
+static inline uns32 ascii_span
+	( const char * p, const char * endp )
+{
+    const char * beginp = p;
+    const uns64 HIGH = 0x8080808080808080ull;
+    while ( endp - p >= 16 )
+    {
+        uns64 w0, w1;
+	::memcpy ( & w0, p, 8 );
+	::memcpy ( & w1, p + 8, 8 );
+	if ( ( w0 | w1 ) & HIGH ) break;
+	p += 16;
+    }
+    while ( p < endp && ( * p & 0x80 ) == 0 ) ++ p;
+    return p - beginp;
+}
+
+// Compute the indent of character c given the
+// indent of the character before it on the line;
+// see the inchar indent member in ll_lexeme.h.
+//
+static inline uns32 next_indent
+	( uns32 indent, Uchar c )
+{
+    if ( indent == AFTER_GRAPHIC ) return indent;
+    min::uns16 i = min::Uindex ( c );
+    if ( i >= min::unicode::index_limit )
+	return AFTER_GRAPHIC;
+
+    // We use min::standard_flags to find out if `c'
+    // is in a graphic category (L, M, P, or S) or in
+    // category Zs.
+    //
+    min::uns32 flags = min::standard_char_flags[i];
+    if ( flags & min::IS_GRAPHIC )
+	return AFTER_GRAPHIC;
+    else if ( c == '\t' )
+	return indent + 8 - indent % 8;
+    else if ( flags & min::IS_HSPACE )
+	return indent + 1;
+    else
+        return indent;
+}
+
+// Record the offsets of the characters of the last
+// input_lines element, if not already recorded.
+//
+static void compact_byte_offsets
+	( LEX::scanner scanner )
+{
+    LEX::input_lines input_lines = scanner->input_lines;
+    LEX::input_offsets input_offsets =
+        scanner->input_offsets;
+    min::ptr<LEX::input_line> lp =
+        & input_lines[input_lines->length - 1];
+    if ( lp->byte_offsets != LEX::NO_BYTE_OFFSETS )
+        return;
+
+    lp->byte_offsets = input_offsets->length;
+    uns32 n = LEX::input_length ( scanner ) - lp->first;
+    for ( uns32 k = 0; k < n; ++ k )
+        min::push(input_offsets) =
+	    lp->position.offset + k;
+}
+
+// Move the input characters from input_bytes to
+// input_chars, as a non-ASCII character is about to
+// be added.
+//
+static void widen_input ( LEX::scanner scanner )
+{
+    LEX::input_bytes input_bytes = scanner->input_bytes;
+    LEX::input_chars input_chars = scanner->input_chars;
+    MIN_REQUIRE ( input_chars->length == 0 );
+
+    uns32 n = input_bytes->length;
+    if ( n > 0 )
+    {
+	min::push ( input_chars, n );
+	Uchar * q = ~ & input_chars[0];
+	const uns8 * b = ~ & input_bytes[0];
+	for ( uns32 j = 0; j < n; ++ j )
+	    q[j] = b[j];
+	min::pop ( input_bytes, n );
+    }
+    scanner->byte_input = false;
+}
+
+// Move the input characters from input_chars back to
+// input_bytes.  They must all be ASCII.
+//
+static void narrow_input ( LEX::scanner scanner )
+{
+    LEX::input_bytes input_bytes = scanner->input_bytes;
+    LEX::input_chars input_chars = scanner->input_chars;
+    MIN_REQUIRE ( input_bytes->length == 0 );
+
+    uns32 n = input_chars->length;
+    if ( n > 0 )
+    {
+	min::push ( input_bytes, n );
+	uns8 * b = ~ & input_bytes[0];
+	const Uchar * q = ~ & input_chars[0];
+	for ( uns32 j = 0; j < n; ++ j )
+	    b[j] = (uns8) q[j];
+	min::pop ( input_chars, n );
+    }
+    scanner->byte_input = true;
+}
+
+// Compact input version of decode_line below.
+//
+static void compact_decode_line
+	( LEX::scanner scanner,
+	  LEX::inchar & ic,
+	  min::ptr<const char> text, uns32 length,
+	  bool add_eol )
+{
+    LEX::input_chars input_chars =
+        scanner->input_chars;
+    LEX::input_lines input_lines =
+        scanner->input_lines;
+    LEX::input_offsets input_offsets =
+        scanner->input_offsets;
+
+    LEX::input_line line;
+    line.first = LEX::input_length ( scanner );
+    line.position = ic;
+    line.indent = ic.indent;
+    line.byte_offsets = LEX::NO_BYTE_OFFSETS;
+    min::push(input_lines) = line;
+    bool has_offsets = false;
+    uns32 offset = 0;
+
+    while ( length != 0 )
+    {
+	const char * beginp = ~ ( text + offset );
+	const char * endp = beginp + length;
+
+	uns32 n = ::ascii_span ( beginp, endp );
+	if ( n > 0 && scanner->byte_input )
+	{
+	    LEX::input_bytes input_bytes =
+	        scanner->input_bytes;
+	    uns32 start = input_bytes->length;
+	    min::push ( input_bytes, n );
+
+	    // The push may have moved the text.
+	    //
+	    const unsigned char * b =
+	        (const unsigned char *)
+	        ~ ( text + offset );
+	    memcpy ( ~ & input_bytes[start], b, n );
+	    for ( uns32 j = 0;
+	          j < n && ic.indent != AFTER_GRAPHIC;
+		  ++ j )
+		ic.indent = ::next_indent
+		    ( ic.indent, b[j] );
+
+	    ic.offset += n;
+	    offset += n;
+	    length -= n;
+	    continue;
+	}
+	else if ( n > 0 )
+	{
+	    uns32 start = input_chars->length;
+	    min::push ( input_chars, n );
+
+	    // The push may have moved the text.
+	    //
+	    const unsigned char * b =
+	        (const unsigned char *)
+	        ~ ( text + offset );
+	    Uchar * q = ~ & input_chars[start];
+	    for ( uns32 j = 0; j < n; ++ j )
+		q[j] = b[j];
+	    for ( uns32 j = 0;
+	          j < n && ic.indent != AFTER_GRAPHIC;
+		  ++ j )
+		ic.indent = ::next_indent
+		    ( ic.indent, b[j] );
+	    if ( has_offsets )
+		for ( uns32 j = 0; j < n; ++ j )
+		    min::push(input_offsets) =
+		        ic.offset + j;
+
+	    ic.offset += n;
+	    offset += n;
+	    length -= n;
+	    continue;
+	}
+
+	const char * p = beginp;
+	Uchar unicode =
+	    min::utf8_to_unicode ( p, endp );
+	uns32 bytes_read = p - beginp;
+	MIN_REQUIRE ( length >= bytes_read );
+	offset += bytes_read;
+	length -= bytes_read;
+
+	if ( scanner->byte_input )
+	    ::widen_input ( scanner );
+	if ( ! has_offsets )
+	{
+	    ::compact_byte_offsets ( scanner );
+	    has_offsets = true;
+	}
+	min::push(input_chars) = unicode;
+	min::push(input_offsets) = ic.offset;
+
+	ic.offset += bytes_read;
+	ic.indent = ::next_indent ( ic.indent, unicode );
+    }
+
+    if ( add_eol )
+    {
+	if ( scanner->byte_input )
+	{
+	    LEX::input_bytes input_bytes =
+	        scanner->input_bytes;
+	    min::push(input_bytes) = '\n';
+	}
+	else
+	    min::push(input_chars) = '\n';
+	if ( has_offsets )
+	    min::push(input_offsets) = ic.offset;
+	++ ic.line;
+	ic.offset = 0;
+	ic.indent = 0;
+    }
+
+    scanner->next_position = (min::position) ic;
+    scanner->next_indent = ic.indent;
+}
+
+// Decode a line of UTF-8 text of the given length,
+// appending its characters to the input, followed by
+// a line feed if add_eol is true.  Ic is the position
+// and indent of the first character.  Set scanner->
+// next_position and next_indent.
+//
+// Lines are decoded a span at a time.  A span of
+// ASCII bytes is appended to the input buffer with a
+// single resize and each byte is widened in place.
+// The indent is computed only until the first graph-
+// ic character, after which it is AFTER_GRAPHIC for
+// the rest of the line.  Other bytes are decoded one
+// UTF-8 character at a time.
+//
+// If scanner->compact_input is true, characters are
+// appended to input_chars instead, with one input_
+// lines element for the line.  Byte offsets are
+// recorded only once the line has a non-ASCII
+// character.  If scanner->byte_input is also true,
+// ASCII spans are copied to input_bytes with memcpy
+// until a non-ASCII character widens the input.
+//
+static void decode_line
+	( LEX::scanner scanner,
+	  LEX::inchar & ic,
+	  min::ptr<const char> text, uns32 length,
+	  bool add_eol )
+{
+    if ( scanner->compact_input )
+    {
+	::compact_decode_line
+	    ( scanner, ic, text, length, add_eol );
+	return;
+    }
+
+    LEX::input_buffer input_buffer =
+        scanner->input_buffer;
+    uns32 offset = 0;
+
+    while ( length != 0 )
+    {
+	const char * beginp = ~ ( text + offset );
+	const char * endp = beginp + length;
+
+	uns32 n = ::ascii_span ( beginp, endp );
+	if ( n > 0 )
+	{
+	    uns32 start = input_buffer->length;
+	    min::push ( input_buffer, n );
+
+	    // The push may have moved the text.
+	    //
+	    const unsigned char * b =
+	        (const unsigned char *)
+	        ~ ( text + offset );
+	    LEX::inchar * q =
+	        ~ & input_buffer[start];
+	    uns32 j = 0;
+	    for ( ; j < n
+	            && ic.indent != AFTER_GRAPHIC;
+		  ++ j )
+	    {
+		ic.character = b[j];
+		q[j] = ic;
+		++ ic.offset;
+		ic.indent = ::next_indent
+		    ( ic.indent, ic.character );
+	    }
+	    for ( ; j < n; ++ j )
+	    {
+		ic.character = b[j];
+		q[j] = ic;
+		++ ic.offset;
+	    }
+
+	    offset += n;
+	    length -= n;
+	    continue;
+	}
+
+	const char * p = beginp;
+	Uchar unicode =
+	    min::utf8_to_unicode ( p, endp );
+	uns32 bytes_read = p - beginp;
+	MIN_REQUIRE ( length >= bytes_read );
+	offset += bytes_read;
+	length -= bytes_read;
+
+	ic.character = unicode;
+	min::push(input_buffer) = ic;
+
+	ic.offset += bytes_read;
+	ic.indent = ::next_indent ( ic.indent, unicode );
+    }
+
+    if ( add_eol )
+    {
+	ic.character = '\n';
+	min::push(input_buffer) = ic;
+	++ ic.line;
+	ic.offset = 0;
+	ic.indent = 0;
+    }
+
+    scanner->next_position = (min::position) ic;
+    scanner->next_indent = ic.indent;
+}
+
+// Add the line with the given line number, length,
+// and add_eol to the line index.  A new line_bases
+// element is started every LINE_INDEX_BLOCK lines.
+//
+static void index_line
+	( LEX::scanner scanner, uns32 line,
+	  uns32 length, bool add_eol )
+{
+    LEX::line_bases bases = scanner->line_bases;
+    LEX::line_deltas deltas = scanner->line_deltas;
+    MIN_REQUIRE ( line == deltas->length );
+
+    uns64 offset = scanner->index_next;
+    if ( line % LEX::LINE_INDEX_BLOCK == 0 )
+        min::push(bases) = offset;
+    uns64 delta =
+        offset - bases[line / LEX::LINE_INDEX_BLOCK];
+    MIN_ASSERT ( delta < ( uns64 ( 1 ) << 32 ),
+                 "line index block too long" );
+    min::push(deltas) = (uns32) delta;
+    scanner->index_next = offset + length + add_eol;
+}
+
+static bool default_input_get
+	( LEX::scanner scanner,
+	  LEX::input input )
+{
+    min::file file = scanner->input_file;
+
+    LEX::inchar ic;
+    ic.line = scanner->next_position.line;
+    ic.offset = scanner->next_position.offset;
+    ic.indent = scanner->next_indent;
+    MIN_REQUIRE (    ic.line
+                 == file->next_line_number );
+
+    min::uns32 offset = min::next_line ( file );
+    min::uns32 length;
+    bool add_eol = true;
+
+    if ( offset == min::NO_LINE )
+    {
+        length = min::remaining_length ( file );
+        if ( length == 0 ) return false;
+	offset = min::remaining_offset ( file );
+	min::skip_remaining ( file );
+	add_eol = false;
+    }
+    else
+        length = ::strlen ( ~ & file->buffer[offset] );
+
+    if ( scanner->index_lines
+         &&
+	 scanner->line_deltas != NULL_STUB )
+	::index_line
+	    ( scanner, ic.line, length, add_eol );
+
+    ::decode_line
+        ( scanner, ic,
+	  min::ptr<const char>
+	      ( & file->buffer[offset] ),
+	  length, add_eol );
+    return true;
+}
+
+// Append the line beginning at p in the memory mapped
+// input, with the given length and add_eol, to
+// scanner->input_file, so its lines can be printed as
+// for any other input.
+//
+static void spool_mapped_line
+	( LEX::scanner scanner, const char * p,
+	  uns32 length, bool add_eol )
+{
+    min::file file = scanner->input_file;
+    min::packed_vec_insptr<char> buffer = file->buffer;
+    min::push ( buffer, length + add_eol,
+                min::new_ptr ( p ) );
+    if ( min::next_line ( file ) == min::NO_LINE )
+        min::skip_remaining ( file );
+}
+
+// Input closure for memory mapped files.  Lines are
+// decoded straight from the mapping, and each line is
+// appended to scanner->input_file the first time it
+// is read.
+//
+static bool mapped_input_get
+	( LEX::scanner scanner,
+	  LEX::input input )
+{
+    uns64 next = scanner->mapped_next;
+    uns64 size = scanner->mapped_size;
+    if ( next >= size ) return false;
+
+    LEX::inchar ic;
+    ic.line = scanner->next_position.line;
+    ic.offset = scanner->next_position.offset;
+    ic.indent = scanner->next_indent;
+
+    const char * beginp = scanner->mapped_data + next;
+    const char * endp = (const char *)
+        ::memchr ( beginp, '\n', size - next );
+    bool add_eol = ( endp != NULL );
+    if ( ! add_eol )
+        endp = scanner->mapped_data + size;
+    uns64 length = endp - beginp;
+    MIN_ASSERT ( length < ( uns64 ( 1 ) << 32 ),
+                 "mapped file line too long" );
+    scanner->mapped_next = next + length + add_eol;
+
+    if (    ic.line
+         == scanner->input_file->next_line_number )
+	::spool_mapped_line
+	    ( scanner, beginp, (uns32) length, add_eol );
+
+    ::decode_line
+        ( scanner, ic, min::new_ptr ( beginp ),
+	  (uns32) length, add_eol );
+    return true;
+}
+
+// Input closure for init_input_span.  Lines are
+// decoded straight from scanner->span_text.
+//
+static bool span_input_get
+	( LEX::scanner scanner,
+	  LEX::input input )
+{
+    LEX::span_text text = scanner->span_text;
+    uns32 next = scanner->span_next;
+    if ( next >= text->length ) return false;
+
+    LEX::inchar ic;
+    ic.line = scanner->next_position.line;
+    ic.offset = scanner->next_position.offset;
+    ic.indent = scanner->next_indent;
+
+    const char * beginp = ~ & text[next];
+    const char * endp = (const char *)
+        ::memchr ( beginp, '\n', text->length - next );
+    bool add_eol = ( endp != NULL );
+    if ( ! add_eol )
+        endp = ~ & text[0] + text->length;
+    uns32 length = endp - beginp;
+    scanner->span_next = next + length + add_eol;
+
+    ::decode_line
+        ( scanner, ic,
+	  min::ptr<const char> ( & text[next] ),
+	  length, add_eol );
+    return true;
+}
+
+static void default_erroneous_atom_announce
+	( uns32 first, uns32 next, uns32 type,
+	  LEX::scanner scanner,
+	  LEX::erroneous_atom erroneous_atom )
+{
+    if ( scanner->printer == min::NULL_STUB )
+        min::init ( LEX::printer_ref(scanner) );
+
+    ++ erroneous_atom->count;
+
+    scanner->printer
+        << "ERRONEOUS ATOM: ";
+
+    if ( erroneous_atom->mode == LEX::BASIC )
+    {
+        scanner->printer
+	    << LEX::perroneous_atom
+	           ( scanner, first, next, type )
+	    << min::eol;
+	return;
+    }
+
+    scanner->printer
+        << LEX::pmode ( scanner->program, type );
+
+    switch ( erroneous_atom->mode )
+    {
+    case NORMAL:
+	scanner->printer
+	    << " " << LEX::pline_numbers
+	                  ( scanner, first, next );
+
+	// Falls through.
+    case NO_LINE_NUMBERS:
+	scanner->printer << ":" << min::eol;
+
+	LEX::print_phrase_lines
+	    ( scanner->printer, scanner, first, next );
+	break;
+
+    default:
+        MIN_ABORT
+	    ( "Bad erroneous atom announce mode" );
+    }
+}
+
+void LEX::init
+	( min::ref<LEX::input> input,
+	  bool (*get) ( LEX::scanner scanner,
+			LEX::input input ) )
 {
     if ( input == NULL_STUB )
         input = ::input_type.new_stub();
@@ -958,6 +2631,10 @@ static void initialize ()
 {
     LEX::init ( LEX::default_input,
 		::default_input_get );
+    LEX::init ( ::mapped_input,
+		::mapped_input_get );
+    LEX::init ( ::span_input,
+		::span_input_get );
     LEX::init ( LEX::default_erroneous_atom,
 		::default_erroneous_atom_announce );
 }
@@ -989,31 +2666,410 @@ inline bool is_recursive
 // pctype XXX.  We check this with MIN_ASSERTs (the
 // attach statements check this).  Everything else
 // found wrong with the program is a SCAN_ERROR.
+//
+// If init_program verified the program, scan_atom<
+// false> and scan omit the checks made by verify_
+// program, unless scanner->checked is true.
+
+// Return the index in scanner->input_lines of the line
+// containing input character i.  Lines are in input
+// order so we can use binary search.
+//
+static uns32 compact_line_of
+	( LEX::scanner scanner, uns32 i )
+{
+    LEX::input_lines input_lines = scanner->input_lines;
+    uns32 low = 0, high = input_lines->length;
+    MIN_REQUIRE ( high > 0 );
+    while ( high - low > 1 )
+    {
+        uns32 mid = ( low + high ) / 2;
+	if ( (&input_lines[mid])->first <= i )
+	    low = mid;
+	else
+	    high = mid;
+    }
+    return low;
+}
+
+// Compute position and indent of input character i.
+//
+static void compact_position
+	( LEX::scanner scanner, uns32 i,
+	  min::position & position, uns32 & indent )
+{
+    LEX::input_lines input_lines = scanner->input_lines;
+    min::ptr<LEX::input_line> lp =
+        & input_lines[::compact_line_of ( scanner, i )];
+
+    position = lp->position;
+    if ( lp->byte_offsets == LEX::NO_BYTE_OFFSETS )
+        position.offset += i - lp->first;
+    else
+        position.offset =
+	    scanner->input_offsets
+	        [lp->byte_offsets + i - lp->first];
+
+    indent = lp->indent;
+    for ( uns32 k = lp->first;
+          k < i && indent != AFTER_GRAPHIC; ++ k )
+        indent = ::next_indent
+	    ( indent, LEX::input_character
+	                  ( scanner, k ) );
+}
+
+min::position LEX::input_position
+	( LEX::scanner scanner, uns32 i )
+{
+    if ( i >= LEX::input_length ( scanner ) )
+        return scanner->next_position;
+    else if ( ! scanner->compact_input )
+        return (min::position)
+	       scanner->input_buffer[i];
+
+    min::position position;
+    uns32 indent;
+    ::compact_position ( scanner, i, position, indent );
+    return position;
+}
+
+uns32 LEX::input_indent
+	( LEX::scanner scanner, uns32 i )
+{
+    if ( i >= LEX::input_length ( scanner ) )
+        return scanner->next_indent;
+    else if ( ! scanner->compact_input )
+        return (&scanner->input_buffer[i])->indent;
+
+    min::position position;
+    uns32 indent;
+    ::compact_position ( scanner, i, position, indent );
+    return indent;
+}
+
+min::position LEX::offset_position
+	( LEX::scanner scanner, uns64 offset )
+{
+    LEX::line_bases bases = scanner->line_bases;
+    LEX::line_deltas deltas = scanner->line_deltas;
+    MIN_REQUIRE ( deltas->length > 0 );
+    MIN_REQUIRE ( offset >= bases[0] );
+
+    // Find the last block beginning at or before
+    // offset, and then the last line in it.
+    //
+    uns32 low = 0, high = bases->length;
+    while ( high - low > 1 )
+    {
+        uns32 mid = ( low + high ) / 2;
+	if ( bases[mid] <= offset ) low = mid;
+	else high = mid;
+    }
+    uns32 line = low * LEX::LINE_INDEX_BLOCK;
+    uns32 end = line + LEX::LINE_INDEX_BLOCK;
+    if ( end > deltas->length ) end = deltas->length;
+    uns64 delta = offset - bases[low];
+    while (    line + 1 < end
+            && deltas[line + 1] <= delta )
+        ++ line;
+
+    min::position position;
+    position.line = line;
+    position.offset =
+        (uns32) ( delta - deltas[line] );
+    return position;
+}
+
+// Remove input characters 0 .. n-1 and rebase the
+// input_lines and input_offsets of the rest.  The
+// first line kept has its first, position, indent,
+// and byte_offsets advanced to the new input char-
+// acter 0.  If ascii_input is true and the remaining
+// characters are all ASCII, return them to input_
+// bytes.
+//
+static void compact_shift
+	( LEX::scanner scanner, uns32 n )
+{
+    LEX::input_chars input_chars = scanner->input_chars;
+    LEX::input_bytes input_bytes = scanner->input_bytes;
+    LEX::input_lines input_lines = scanner->input_lines;
+    LEX::input_offsets input_offsets =
+        scanner->input_offsets;
+
+    if ( n >= LEX::input_length ( scanner ) )
+    {
+        min::pop ( input_chars, input_chars->length );
+	if ( input_bytes != NULL_STUB )
+	    min::pop ( input_bytes,
+	               input_bytes->length );
+        min::pop ( input_lines, input_lines->length );
+        min::pop ( input_offsets,
+	           input_offsets->length );
+	scanner->byte_input =
+	    ( input_bytes != NULL_STUB
+	      &&
+	      scanner->ascii_input );
+	return;
+    }
+    if ( n == 0 ) return;
+
+    uns32 first_line = ::compact_line_of ( scanner, n );
+    min::ptr<LEX::input_line> lp =
+        & input_lines[first_line];
+    ::compact_position
+        ( scanner, n, lp->position, lp->indent );
+    if ( lp->byte_offsets != LEX::NO_BYTE_OFFSETS )
+        lp->byte_offsets += n - lp->first;
+    lp->first = n;
+
+    uns32 lines = input_lines->length - first_line;
+    uns32 offset_base = input_offsets->length;
+    for ( uns32 k = 0; k < lines; ++ k )
+    {
+	uns32 bo =
+	    (&input_lines[first_line + k])
+	        ->byte_offsets;
+        if ( bo != LEX::NO_BYTE_OFFSETS )
+	{
+	    offset_base = bo;
+	    break;
+	}
+    }
+    for ( uns32 k = 0; k < lines; ++ k )
+    {
+        LEX::input_line line =
+	    input_lines[first_line + k];
+	line.first -= n;
+        if ( line.byte_offsets != LEX::NO_BYTE_OFFSETS )
+	    line.byte_offsets -= offset_base;
+	input_lines[k] = line;
+    }
+    min::pop ( input_lines, first_line );
+
+    uns32 offsets = input_offsets->length - offset_base;
+    if ( offsets > 0 )
+	memmove ( ~ & input_offsets[0],
+		  ~ & input_offsets[offset_base],
+		  offsets * sizeof ( uns32 ) );
+    min::pop ( input_offsets, offset_base );
+
+    if ( scanner->byte_input )
+    {
+	memmove ( ~ & input_bytes[0],
+		  ~ & input_bytes[n],
+		  input_bytes->length - n );
+	min::pop ( input_bytes, n );
+	return;
+    }
+
+    memmove ( ~ & input_chars[0],
+	      ~ & input_chars[n],
+	        ( input_chars->length - n )
+	      * sizeof ( Uchar ) );
+    min::pop ( input_chars, n );
+
+    // Lines with non-ASCII characters have byte
+    // offsets, so if none are left the rest is ASCII.
+    //
+    if ( input_offsets->length == 0
+         &&
+	 input_bytes != NULL_STUB
+	 &&
+	 scanner->ascii_input )
+	::narrow_input ( scanner );
+}
+
+int LEX::read_ahead_stream::active = 0;
+
+void LEX::close_input ( LEX::scanner scanner )
+{
+    if ( scanner->input == ::span_input )
+        LEX::input_ref(scanner) = NULL_STUB;
+
+    if ( scanner->read_ahead != NULL )
+    {
+        delete scanner->read_ahead;
+	scanner->read_ahead = NULL;
+    }
+
+    if ( scanner->mapped_data == NULL ) return;
+
+    if ( scanner->mapped_size > 0 )
+	::munmap ( (void *) scanner->mapped_data,
+		   scanner->mapped_size );
+    scanner->mapped_data = NULL;
+    scanner->mapped_size = 0;
+    scanner->mapped_next = 0;
+    if ( scanner->input == ::mapped_input )
+        LEX::input_ref(scanner) = NULL_STUB;
+}
+
+void LEX::init ( min::ref<LEX::scanner> scanner )
+{
+
+    if ( scanner == NULL_STUB )
+    {
+	scanner = scanner_type.new_stub();
+
+	LEX::input_buffer_ref(scanner) =
+	    inchar_vec_type.new_gen();
+	LEX::translation_buffer_ref(scanner) =
+	    Uchar_vec_type.new_gen();
+    }
+    else
+    {
+	min::pop ( scanner->input_buffer,
+		   scanner->input_buffer->length );
+	min::pop
+	    ( scanner->translation_buffer,
+	      scanner->translation_buffer->length );
+	if ( scanner->input_chars != NULL_STUB )
+	    ::compact_shift
+	        ( scanner,
+		  LEX::input_length ( scanner ) );
+	if ( scanner->mapped_data != NULL )
+	    scanner->mapped_next = 0;
+	if ( scanner->line_deltas != NULL_STUB )
+	{
+	    scanner->index_next = 0;
+	    min::pop
+	        ( scanner->line_bases,
+		  scanner->line_bases->length );
+	    min::pop
+	        ( scanner->line_deltas,
+		  scanner->line_deltas->length );
+	}
+    }
+
+    scanner->reinitialize = true;
+}
+
+// Return the flat state of the dispatcher with the
+// given ID, or 0 if none.  Flat states are in program
+// order so we can use binary search.
+//
+inline uns32 flat_state_of
+	( LEX::flat_states states, uns32 dispatcher_ID )
+{
+    uns32 low = 1, high = states->length;
+    while ( low < high )
+    {
+        uns32 mid = ( low + high ) / 2;
+	uns32 ID = (&states[mid])->dispatcher_ID;
+	if ( ID == dispatcher_ID ) return mid;
+	else if ( ID < dispatcher_ID ) low = mid + 1;
+	else high = mid;
+    }
+    return 0;
+}
+
+// Build new scanner->flat_states, flat_transitions,
+// and flat_ascii from scanner->program.  Leave them
+// empty if the program cannot be flattened.  They are
+// not changed once built, so scanners may share them.
+//
+static void flatten_program ( LEX::scanner scanner )
+{
+    LEX::program program = scanner->program;
+
+    LEX::flat_states_ref(scanner) =
+	flat_state_vec_type.new_gen();
+    LEX::flat_transitions_ref(scanner) =
+	flat_transition_vec_type.new_gen();
+    LEX::flat_ascii_ref(scanner) =
+	uns32_vec_type.new_gen();
 
-void LEX::init ( min::ref<LEX::scanner> scanner )
-{
+    LEX::flat_states states = scanner->flat_states;
+    LEX::flat_transitions transitions =
+        scanner->flat_transitions;
+    LEX::flat_ascii ascii = scanner->flat_ascii;
 
-    if ( scanner == NULL_STUB )
+    // State 0 is the `no dispatcher' state.
+    //
+    LEX::flat_state s0 = { 0, 0, 0, 0 };
+    min::push(states) = s0;
+    min::push ( ascii, 128 );
+
+    for ( uns32 ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
     {
-	scanner = scanner_type.new_stub();
+        if ( program[ID] != DISPATCHER ) continue;
 
-	LEX::input_buffer_ref(scanner) =
-	    inchar_vec_type.new_gen();
-	LEX::translation_buffer_ref(scanner) =
-	    Uchar_vec_type.new_gen();
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	min::ptr<map_element> mep =
+	    LEX::ptr<map_element>
+		( program, ID + dispatcher_header_length );
+
+	LEX::flat_state s;
+	s.dispatcher_ID = ID;
+	s.first_transition = transitions->length;
+	s.ctype_map_size = dhp->ctype_map_size;
+	s.ctype_map_ID = ctype_map_ID_of ( ID, dhp );
+	min::push(states) = s;
+
+	// next_state is set to the dispatcher ID here
+	// and converted to a flat state below.
+	//
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	{
+	    LEX::flat_transition tr;
+	    tr.next_state = (&mep[t])->dispatcher_ID;
+	    tr.instruction_ID =
+	        (&mep[t])->instruction_ID;
+	    tr.repeat_count = (&mep[t])->repeat_count;
+	    min::push(transitions) = tr;
+	}
+
+	if (    ::max_map_ctype ( program, ID )
+	     > dhp->max_ctype )
+	    goto FAIL;
+	for ( Uchar c = 0; c < 128; ++ c )
+	{
+	    uns32 ctype = map_ctype
+	        ( program, s.ctype_map_ID,
+		  s.ctype_map_size, min::Uindex ( c ) );
+	    min::push(ascii) =
+	        s.first_transition + ctype;
+	}
     }
-    else
+
+    for ( uns32 i = 0; i < transitions->length; ++ i )
     {
-	min::pop ( scanner->input_buffer,
-		   scanner->input_buffer->length );
-	min::pop
-	    ( scanner->translation_buffer,
-	      scanner->translation_buffer->length );
+	min::ptr<LEX::flat_transition> tp =
+	    & transitions[i];
+	if ( tp->next_state == 0 ) continue;
+	tp->next_state =
+	    ::flat_state_of ( states, tp->next_state );
+	if ( tp->next_state == 0 ) goto FAIL;
     }
 
-    scanner->reinitialize = true;
+    return;
+
+FAIL:
+    min::pop ( states, states->length );
+    min::pop ( transitions, transitions->length );
+    min::pop ( ascii, ascii->length );
 }
 
+// The program last given to init_program, its length
+// and program_hash, and its verify_program result and
+// flat tables.  Scanners initialized with the same
+// unchanged program share these instead of verifying
+// and flattening the program again.
+//
+static min::locatable_var<LEX::program> cached_program;
+static uns32 cached_length;
+static uns32 cached_hash;
+static bool cached_verified;
+static min::locatable_var<LEX::flat_states>
+    cached_flat_states;
+static min::locatable_var<LEX::flat_transitions>
+    cached_flat_transitions;
+static min::locatable_var<LEX::flat_ascii>
+    cached_flat_ascii;
+
 void LEX::init_program
 	( min::ref<LEX::scanner> scanner,
 	  LEX::program program,
@@ -1022,6 +3078,7 @@ void LEX::init_program
     init ( scanner );
     program_ref(scanner) = program;
     scanner->initial_table = initial_table;
+    scanner->compiled = NULL;
 
     min::uns32 max_master =
 	LEXDATA::max_master ( program );
@@ -1080,6 +3137,85 @@ void LEX::init_program
 	else
 	    vp[t] = min::MISSING();
     }
+
+    LEX::program last_program = ::cached_program;
+    const min::stub * last_s = last_program;
+    const min::stub * program_s = program;
+    if ( last_s == program_s
+         &&
+	 ::cached_length == program->length
+	 &&
+	 ::cached_hash == LEX::program_hash ( program ) )
+    {
+	scanner->verified = ::cached_verified;
+	LEX::flat_states_ref(scanner) =
+	    ::cached_flat_states;
+	LEX::flat_transitions_ref(scanner) =
+	    ::cached_flat_transitions;
+	LEX::flat_ascii_ref(scanner) =
+	    ::cached_flat_ascii;
+    }
+    else
+    {
+	scanner->verified =
+	    LEX::verify_program ( program );
+	::flatten_program ( scanner );
+
+	::cached_program = program;
+	::cached_length = program->length;
+	::cached_hash = LEX::program_hash ( program );
+	::cached_verified = scanner->verified;
+	::cached_flat_states = scanner->flat_states;
+	::cached_flat_transitions =
+	    scanner->flat_transitions;
+	::cached_flat_ascii = scanner->flat_ascii;
+    }
+
+    if ( scanner->profile != NULL_STUB )
+        LEX::init_profile
+	    ( scanner, true, scanner->profile_time );
+}
+
+void LEX::init_profile
+	( min::ref<LEX::scanner> scanner,
+	  bool profile, bool time )
+{
+    if ( scanner == NULL_STUB ) init ( scanner );
+
+    if ( ! profile )
+    {
+	profile_ref(scanner) = NULL_STUB;
+	scanner->profile_time = false;
+	return;
+    }
+
+    if ( scanner->profile == NULL_STUB )
+	profile_ref(scanner) = uns64_vec_type.new_gen();
+
+    LEX::profile counts = scanner->profile;
+    min::pop ( counts, counts->length );
+    if ( scanner->program != NULL_STUB )
+	min::push ( counts, scanner->program->length );
+    scanner->profile_time = time;
+}
+
+void LEX::init_checkpoints
+	( min::ref<LEX::scanner> scanner,
+	  bool checkpoints )
+{
+    if ( scanner == NULL_STUB ) init ( scanner );
+
+    if ( ! checkpoints )
+    {
+	checkpoints_ref(scanner) = NULL_STUB;
+	return;
+    }
+
+    if ( scanner->checkpoints == NULL_STUB )
+	checkpoints_ref(scanner) =
+	    checkpoint_vec_type.new_gen();
+    min::pop ( scanner->checkpoints,
+               scanner->checkpoints->length );
 }
 
 void LEX::init_input_file
@@ -1087,6 +3223,7 @@ void LEX::init_input_file
 	  min::file input_file )
 {
     init ( scanner );
+    LEX::close_input ( scanner );
     input_file_ref(scanner) = input_file;
 }
 
@@ -1106,6 +3243,7 @@ bool LEX::init_input_named_file
 	  
 {
     init ( scanner );
+    LEX::close_input ( scanner );
     return min::init_input_named_file
 	( input_file_ref(scanner),
 	  file_name,
@@ -1120,6 +3258,7 @@ void LEX::init_input_stream
 	  uns32 spool_lines )
 {
     init ( scanner );
+    LEX::close_input ( scanner );
     min::init_input_stream
 	( input_file_ref(scanner),
 	  istream, line_format, spool_lines );
@@ -1132,17 +3271,109 @@ void LEX::init_input_string
 	  uns32 spool_lines )
 {
     init ( scanner );
+    LEX::close_input ( scanner );
     min::init_input_string
 	( input_file_ref(scanner),
 	  data, line_format, spool_lines );
 }
 
+void LEX::init_input_span
+	( min::ref<LEX::scanner> scanner,
+	  min::ptr<const char> data, uns32 length,
+	  const min::line_format * line_format )
+{
+    if (    scanner != NULL_STUB
+         && scanner->input == ::span_input )
+    {
+	init ( scanner );
+	min::file file = scanner->input_file;
+	if ( file->buffer->length > 0
+	     ||
+	     file->line_format != line_format )
+	    min::init_input
+		( input_file_ref(scanner), line_format,
+		  min::ALL_LINES );
+    }
+    else
+    {
+	init ( scanner );
+	LEX::close_input ( scanner );
+	min::init_input
+	    ( input_file_ref(scanner), line_format,
+	      min::ALL_LINES );
+	if ( scanner->span_text == NULL_STUB )
+	    LEX::span_text_ref(scanner) =
+		char_vec_type.new_gen();
+	LEX::input_ref(scanner) = ::span_input;
+    }
+
+    LEX::span_text text = scanner->span_text;
+    min::pop ( text, text->length );
+    if ( length > 0 )
+	min::push ( text, length, data );
+    scanner->span_next = 0;
+}
+
+bool LEX::init_input_mapped_file
+	( min::ref<LEX::scanner> scanner,
+	  min::gen file_name,
+	  const min::line_format * line_format,
+	  uns32 spool_lines )
+{
+    init ( scanner );
+    LEX::close_input ( scanner );
+
+    min::str_ptr sp ( file_name );
+    int fd = ::open ( ~ min::begin_ptr_of ( sp ),
+                      O_RDONLY );
+    struct stat st;
+    void * data = MAP_FAILED;
+    if ( fd >= 0 && ::fstat ( fd, & st ) == 0 )
+    {
+        // An empty file cannot be mapped, so we use
+	// an empty string in its place.
+	//
+        if ( st.st_size == 0 )
+	    data = (void *) "";
+	else
+	    data = ::mmap ( NULL, st.st_size, PROT_READ,
+	                    MAP_PRIVATE, fd, 0 );
+    }
+    int saved_errno = errno;
+    if ( fd >= 0 ) ::close ( fd );
+    if ( data == MAP_FAILED )
+    {
+	min::init ( min::error_message )
+	    << "ERROR: cannot map file "
+	    << file_name << ": "
+	    << ::strerror ( saved_errno )
+	    << min::eol;
+        return false;
+    }
+
+    if ( st.st_size > 0 )
+	::madvise ( data, st.st_size,
+	            MADV_SEQUENTIAL );
+    scanner->mapped_data = (const char *) data;
+    scanner->mapped_size = st.st_size;
+    scanner->mapped_next = 0;
+    LEX::input_ref(scanner) = ::mapped_input;
+
+    min::init_input
+        ( input_file_ref(scanner),
+	  line_format, spool_lines );
+    min::init_file_name
+        ( input_file_ref(scanner), file_name );
+    return true;
+}
+
 void LEX::init_input
 	( min::ref<LEX::scanner> scanner,
 	  const min::line_format * line_format,
 	  uns32 spool_lines )
 {
     init ( scanner );
+    LEX::close_input ( scanner );
     min::init_input
         ( input_file_ref(scanner),
 	  line_format, spool_lines );
@@ -1190,22 +3421,522 @@ inline min::printer scan_error
         ( scanner, length, scanner->next );
 }
 
-// Print the instruction at scanner->program[ID] with
-// the given indent and min::eol, if ID is non-zero, and
-// return ID repositioned just after instuction.  How-
-// ever, if scanner->program[ID] does not ==
-// INSTRUCTION, print ILLEGAL instruction message and
-// return scanner->program->length + 1.
+// Print the instruction at scanner->program[ID] with
+// the given indent and min::eol, if ID is non-zero, and
+// return ID repositioned just after instuction.  How-
+// ever, if scanner->program[ID] does not ==
+// INSTRUCTION, print ILLEGAL instruction message and
+// return scanner->program->length + 1.
+//
+// If ID == 0 do nothing but return 0.
+//
+// If no_line_number is true, surpress printing line
+// number/ID (using pID).
+//
+static uns32 print_instruction
+    ( min::printer printer,
+      LEX::program program, uns32 ID,
+      bool no_line_number = false );
+
+// Return the ctype of character c for the dispatcher,
+// tracing it if traced and trace_dispatch.  Return
+// SCAN_ERROR if checked and the ctype is too large.
+//
+template < bool checked, bool traced >
+inline uns32 get_ctype
+	( Uchar c,
+	  LEX::scanner scanner,
+	  LEX::program program,
+	  uns32 dispatcher_ID,
+	  min::ptr<dispatcher_header> dhp,
+	  uns32 length,
+	  bool trace_dispatch,
+	  const char * trace_tag )
+{
+    uns32 ctype = map_ctype
+        ( program, ctype_map_ID_of ( dispatcher_ID, dhp ),
+	  dhp->ctype_map_size, min::Uindex ( c ) );
+
+    if ( traced && trace_dispatch )
+	scanner->printer
+	    << "  " << trace_tag << "Character = "
+	    << pgraphic ( c )
+	    << " Dispatcher = "
+	    << pID ( dispatcher_ID, program )
+	    << " CType = " << ctype << min::eol;
+
+    if ( checked && ctype > dhp->max_ctype )
+    {
+	scan_error ( scanner, length )
+	    << "Ctype " << ctype
+	    << " computed for character "
+	    << pgraphic ( c )
+	    << " is too large for"
+	       " dispatcher "
+	    << pID ( dispatcher_ID,
+		     program )
+	    << min::eol;
+	return LEX::SCAN_ERROR;
+    }
+
+    return ctype;
+}
+
+// Return the index in scanner->flat_transitions of
+// the transition for non-ASCII character c in the
+// flat state sp.
+//
+inline uns32 flat_transition_index
+	( LEX::program program,
+	  min::ptr<LEX::flat_state> sp,
+	  Uchar c )
+{
+    return sp->first_transition
+         + map_ctype ( program, sp->ctype_map_ID,
+	               sp->ctype_map_size,
+		       min::Uindex ( c ) );
+}
+
+// Return the character of an input_buffer or input_
+// chars element.
+//
+inline Uchar char_of ( const LEX::inchar & ic )
+{
+    return ic.character;
+}
+inline Uchar char_of ( Uchar c )
+{
+    return c;
+}
+inline Uchar char_of ( uns8 c )
+{
+    return c;
+}
+
+// Where scan_atom reads input characters from:
+//
+//   BUFFER_INPUT	scanner->input_buffer
+//   CHAR_INPUT		scanner->input_chars
+//   BYTE_INPUT		scanner->input_bytes, which
+//			hold only ASCII characters
+//   ANY_INPUT		any of these, as per scanner->
+//			compact_input and byte_input, as
+//			LEX::input_character does
+//
+// ANY_INPUT is used when tracing or profiling.
+//
+// Reading input may clear scanner->byte_input (see
+// widen_input), so a BYTE_INPUT scan_atom restarts
+// itself as CHAR_INPUT when that happens while it is
+// dispatching, and tests byte_input once per use
+// when it is executing instructions.  Byte_input is
+// only set between atoms, by compact_shift.
+//
+enum input_mode
+{
+    ANY_INPUT		= 0,
+    BUFFER_INPUT	= 1,
+    CHAR_INPUT		= 2,
+    BYTE_INPUT		= 3
+};
+
+// Ditto LEX::input_length and LEX::input_character for
+// the given input mode.
+//
+template < input_mode mode >
+inline uns32 mode_length ( LEX::scanner scanner )
+{
+    if ( mode == BUFFER_INPUT )
+	return scanner->input_buffer->length;
+    else if ( mode == CHAR_INPUT )
+	return scanner->input_chars->length;
+    else if ( mode == BYTE_INPUT )
+	return scanner->input_bytes->length;
+    else
+	return LEX::input_length ( scanner );
+}
+template < input_mode mode >
+inline Uchar mode_character
+	( LEX::scanner scanner, uns32 i )
+{
+    if ( mode == BUFFER_INPUT )
+	return (&scanner->input_buffer[i])->character;
+    else if ( mode == CHAR_INPUT )
+	return scanner->input_chars[i];
+    else if ( mode == BYTE_INPUT )
+	return scanner->input_bytes[i];
+    else
+	return LEX::input_character ( scanner, i );
+}
+
+// Return the length of the run of the end characters
+// at ip that are ASCII and map to transition tindex in
+// the flat_ascii row of a flat state, but at most
+// count.  The run stops at the first non-ASCII
+// character, which the caller must handle.
+//
+// The inchar layout puts characters 16 bytes apart,
+// so rather than SIMD we unroll by 4 and test for
+// non-ASCII characters once per 4 characters.  Bytes
+// (uns8) are always ASCII and are not tested.
+//
+template < typename T >
+inline uns32 flat_ascii_run
+	( const T * ip, uns32 end,
+	  const uns32 * row, uns32 tindex, uns32 count )
+{
+    if ( end > count ) end = count;
+
+    uns32 n = 0;
+    while ( n + 4 <= end )
+    {
+        Uchar c0 = ::char_of ( ip[n] );
+        Uchar c1 = ::char_of ( ip[n+1] );
+        Uchar c2 = ::char_of ( ip[n+2] );
+        Uchar c3 = ::char_of ( ip[n+3] );
+	if ( sizeof ( T ) > 1
+	     &&
+	     ( c0 | c1 | c2 | c3 ) >= 128 ) break;
+	if ( row[c0] != tindex ) return n;
+	if ( row[c1] != tindex ) return n + 1;
+	if ( row[c2] != tindex ) return n + 2;
+	if ( row[c3] != tindex ) return n + 3;
+	n += 4;
+    }
+    while ( n < end )
+    {
+        Uchar c = ::char_of ( ip[n] );
+	if ( ( sizeof ( T ) > 1 && c >= 128 )
+	     ||
+	     row[c] != tindex ) break;
+	++ n;
+    }
+    return n;
+}
+
+// Ditto for the input characters
+//
+//	p .. LEX::input_length ( scanner ) - 1
+//
+// read as per the input mode.  The input is not
+// extended.
+//
+template < input_mode mode >
+inline uns32 flat_ascii_run
+	( LEX::scanner scanner, uns32 p,
+	  const uns32 * row, uns32 tindex, uns32 count )
+{
+    if ( mode == ANY_INPUT )
+        return ! scanner->compact_input ?
+	       ::flat_ascii_run<BUFFER_INPUT>
+		   ( scanner, p, row, tindex, count ) :
+	       scanner->byte_input ?
+	       ::flat_ascii_run<BYTE_INPUT>
+		   ( scanner, p, row, tindex, count ) :
+	       ::flat_ascii_run<CHAR_INPUT>
+		   ( scanner, p, row, tindex, count );
+
+    uns32 length = ::mode_length<mode> ( scanner );
+    if ( p >= length || count == 0 ) return 0;
+    if ( mode == BUFFER_INPUT )
+        return ::flat_ascii_run
+	    ( ~ & scanner->input_buffer[p], length - p,
+	      row, tindex, count );
+    else if ( mode == BYTE_INPUT )
+        return ::flat_ascii_run
+	    ( ~ & scanner->input_bytes[p], length - p,
+	      row, tindex, count );
+    else
+        return ::flat_ascii_run
+	    ( ~ & scanner->input_chars[p], length - p,
+	      row, tindex, count );
+}
+
+// SKIP_TO stop set: the delimiters, the ASCII control
+// characters, and all non-ASCII characters.  ASCII
+// stops are kept in a 128 bit mask.  If there are at
+// most 2 delimiters they are also kept in d, so byte
+// input can be searched 8 bytes at a time.  The set is
+// copied out of the program so the input get function
+// may be called while it is in use.
+//
+struct skip_to_set
+{
+    min::uns64 mask[2];
+    uns32 nd;  // Number of delimiters in d, or 3 if
+               // there are more than 2.
+    uns8 d[2];
+
+    skip_to_set ( LEX::program program, uns32 ID )
+        : nd ( 0 )
+    {
+	mask[0] = 0xFFFFFFFF;		  // 0x00-0x1F
+	mask[1] = min::uns64 ( 1 ) << 63; // 0x7F
+	uns32 count = program[ID++];
+	while ( count -- )
+	{
+	    Uchar c = program[ID++];
+	    if ( c >= 128 ) continue;
+	    mask[c >> 6] |= min::uns64 ( 1 )
+			 << ( c & 63 );
+	    if ( nd < 2 ) d[nd] = c;
+	    if ( nd < 3 ) ++ nd;
+	}
+    }
+
+    bool is_stop ( Uchar c ) const
+    {
+        if ( c < 128 )
+	    return ( mask[c >> 6] >> ( c & 63 ) ) & 1;
+	return true;
+    }
+};
+
+// Return the length of the run of the end characters
+// at ip that are not in the stop set.  Unrolled by 4
+// like flat_ascii_run, testing 4 ASCII characters
+// against the mask at once.
+//
+template < typename T >
+inline uns32 skip_to_run
+	( const T * ip, uns32 end,
+	  const skip_to_set & set )
+{
+    uns32 n = 0;
+    while ( n + 4 <= end )
+    {
+        Uchar c0 = ::char_of ( ip[n] );
+        Uchar c1 = ::char_of ( ip[n+1] );
+        Uchar c2 = ::char_of ( ip[n+2] );
+        Uchar c3 = ::char_of ( ip[n+3] );
+	if ( sizeof ( T ) > 1
+	     &&
+	     ( c0 | c1 | c2 | c3 ) >= 128 ) break;
+	if ( (   ( set.mask[c0 >> 6] >> ( c0 & 63 ) )
+	       | ( set.mask[c1 >> 6] >> ( c1 & 63 ) )
+	       | ( set.mask[c2 >> 6] >> ( c2 & 63 ) )
+	       | ( set.mask[c3 >> 6] >> ( c3 & 63 ) ) )
+	     & 1 )
+	    break;
+	n += 4;
+    }
+    while ( n < end
+            &&
+	    ! set.is_stop ( ::char_of ( ip[n] ) ) )
+	++ n;
+    return n;
+}
+
+// Ditto for input bytes, which are all ASCII.  With at
+// most 2 delimiters, 8 bytes are tested at a time for
+// a control character, DEL, or a delimiter, using
+//
+//	( x - 0x0101... ) & ~ x & 0x8080...
+//
+// which is non-zero iff some byte of x is 0, and its
+// variant for some byte of x less than 0x20.
+//
+inline uns32 skip_to_run
+	( const uns8 * ip, uns32 end,
+	  const skip_to_set & set )
+{
+    const min::uns64 ONES = 0x0101010101010101ULL;
+    const min::uns64 HIGHS = 0x8080808080808080ULL;
+
+    uns32 n = 0;
+    if ( set.nd <= 2 )
+    {
+	min::uns64 d0 = ONES * set.d[0];
+	min::uns64 d1 = ONES * set.d[set.nd == 2];
+	    // d1 == d0 if there is only 1 delimiter.
+	while ( n + 8 <= end )
+	{
+	    min::uns64 x;
+	    memcpy ( & x, ip + n, 8 );
+	    min::uns64 del = x ^ ( ONES * 0x7F );
+	    min::uns64 hit =
+		  ( ( x - ONES * 0x20 ) & ~ x & HIGHS )
+		| ( ( del - ONES ) & ~ del & HIGHS );
+	    if ( set.nd > 0 )
+	    {
+		min::uns64 x0 = x ^ d0;
+		min::uns64 x1 = x ^ d1;
+		hit |= ( ( x0 - ONES ) & ~ x0 & HIGHS )
+		     | ( ( x1 - ONES ) & ~ x1 & HIGHS );
+	    }
+	    if ( hit != 0 ) break;
+	    n += 8;
+	}
+    }
+    return n + ::skip_to_run<uns8>
+		   ( ip + n, end - n, set );
+}
+
+// Ditto for the input characters
+//
+//	p .. LEX::input_length ( scanner ) - 1
+//
+// read as per the input mode.  The input is not
+// extended.  As this is used when executing
+// instructions, BYTE_INPUT is checked against
+// scanner->byte_input.
+//
+template < input_mode mode >
+inline uns32 skip_to_run
+	( LEX::scanner scanner, uns32 p,
+	  const skip_to_set & set )
+{
+    if ( mode == ANY_INPUT )
+        return ! scanner->compact_input ?
+	       ::skip_to_run<BUFFER_INPUT>
+		   ( scanner, p, set ) :
+	       scanner->byte_input ?
+	       ::skip_to_run<BYTE_INPUT>
+		   ( scanner, p, set ) :
+	       ::skip_to_run<CHAR_INPUT>
+		   ( scanner, p, set );
+    if ( mode == BYTE_INPUT && ! scanner->byte_input )
+        return ::skip_to_run<CHAR_INPUT>
+		   ( scanner, p, set );
+
+    uns32 length = ::mode_length<mode> ( scanner );
+    if ( p >= length ) return 0;
+    if ( mode == BUFFER_INPUT )
+        return ::skip_to_run
+	    ( ~ & scanner->input_buffer[p], length - p,
+	      set );
+    else if ( mode == BYTE_INPUT )
+        return ::skip_to_run
+	    ( ~ & scanner->input_bytes[p], length - p,
+	      set );
+    else
+        return ::skip_to_run
+	    ( ~ & scanner->input_chars[p], length - p,
+	      set );
+}
+
+// Maximum number of memo_table entries.  Entries only
+// live until scanner->next advances, so few are ever
+// needed.
+//
+const uns32 memo_table_size = 16;
+
+// Empty the memo table.
+//
+inline void memo_clear ( LEX::scanner scanner )
+{
+    if ( scanner->memo_table == NULL_STUB ) return;
+    min::pop ( scanner->memo_table,
+               scanner->memo_table->length );
+    min::pop ( scanner->memo_translations,
+               scanner->memo_translations->length );
+}
+
+// Return 1 + the index of the memo table entry with
+// the given ID for the input offset scanner->next, or
+// 0 if none.  If length is not ANY_LENGTH the entry
+// length must also equal length.
+//
+const uns32 ANY_LENGTH = 0xFFFFFFFF;
+inline uns32 memo_find
+	( LEX::scanner scanner, uns32 ID,
+	  uns32 length = ANY_LENGTH )
+{
+    LEX::memo_table table = scanner->memo_table;
+    if ( table == NULL_STUB ) return 0;
+    for ( uns32 i = 0; i < table->length; ++ i )
+    {
+	min::ptr<LEX::memo_entry> mp = & table[i];
+	if ( mp->ID == ID
+	     &&
+	     mp->offset == scanner->next
+	     &&
+	     ( length == ANY_LENGTH
+	       ||
+	       mp->length == length ) )
+	    return i + 1;
+    }
+    return 0;
+}
+
+// Add a memo table entry for the input offset
+// scanner->next, remembering translation_buffer
+// [tnext .. length-1] as its translation.  Do nothing
+// if the table is full.
+//
+static void memo_store
+	( LEX::scanner scanner, uns32 ID,
+	  uns32 result, uns32 length, uns32 tnext )
+{
+    if ( scanner->memo_table == NULL_STUB )
+    {
+	LEX::memo_table_ref(scanner) =
+	    memo_entry_vec_type.new_gen();
+	LEX::memo_translations_ref(scanner) =
+	    Uchar_vec_type.new_gen();
+    }
+
+    LEX::memo_table table = scanner->memo_table;
+    if ( table->length >= ::memo_table_size ) return;
+
+    LEX::translation_buffer translation_buffer =
+        scanner->translation_buffer;
+    LEX::translation_buffer translations =
+        scanner->memo_translations;
+
+    LEX::memo_entry e;
+    e.ID = ID;
+    e.offset = scanner->next;
+    e.result = result;
+    e.length = length;
+    e.translation_first = translations->length;
+    e.translation_length =
+        translation_buffer->length - tnext;
+    if ( e.translation_length > 0 )
+	min::push ( translations, e.translation_length,
+		    min::ptr<const Uchar>
+		        ( & translation_buffer[tnext] ) );
+    min::push(table) = e;
+}
+
+// Pseudo trace flag set in the trace of scan_atom when
+// the scanner is profiling; never taken from scanner->
+// trace.
 //
-// If ID == 0 do nothing but return 0.
+const uns32 PROFILE_FLAG = ( 1 << 31 );
+
+// Return true if the scanner is profiling the program.
 //
-// If no_line_number is true, surpress printing line
-// number/ID (using pID).
+inline bool is_profiling
+	( LEX::scanner scanner, LEX::program program )
+{
+    return scanner->profile != NULL_STUB
+           &&
+	   scanner->profile->length == program->length;
+}
+
+// Add n to profile[index].
 //
-static uns32 print_instruction
-    ( min::printer printer,
-      LEX::program program, uns32 ID,
-      bool no_line_number = false );
+inline void profile_count
+	( LEX::profile profile, uns32 index,
+	  uns64 n = 1 )
+{
+    profile[index] = profile[index] + n;
+}
+
+// Count a character dispatched by a dispatcher and
+// the map element selected by its ctype.
+//
+inline void profile_dispatch
+	( LEX::profile profile,
+	  uns32 dispatcher_ID, uns32 ctype )
+{
+    ::profile_count ( profile, dispatcher_ID );
+    ::profile_count
+        ( profile,   dispatcher_ID
+	           + dispatcher_header_length
+		   + map_element_length * ctype );
+}
 
 // Scan atom given current table.  Locate and process
 // instruction group, but not
@@ -1223,77 +3954,68 @@ static uns32 print_instruction
 // error, return atom_length in argument variable and
 // add translation of atom to translation buffer.
 //
-inline uns32 get_ctype
-	( Uchar c,
-	  LEX::scanner scanner,
-	  LEX::program program,
-	  uns32 dispatcher_ID,
-	  min::ptr<dispatcher_header> dhp,
-	  uns32 length,
-	  bool trace_dispatch,
-	  const char * trace_tag )
-{
-    min::ptr<const uns8> ctype_map =
-	LEX::ptr<const uns8>
-	    ( program,
-		dispatcher_ID
-	      + dispatcher_header_length
-	      +   ( dhp->max_ctype + 1 )
-		* map_element_length );
-
-    uns32 cindex = min::Uindex ( c );
-    uns32 ctype = ( cindex < dhp->ctype_map_size ?
-	            ctype_map[cindex] : 0 );
-
-    if ( trace_dispatch )
-	scanner->printer
-	    << "  " << trace_tag << "Character = "
-	    << pgraphic ( c )
-	    << " Dispatcher = "
-	    << pID ( dispatcher_ID, program )
-	    << " CType = " << ctype << min::eol;
-
-    if ( ctype > dhp->max_ctype )
-    {
-	scan_error ( scanner, length )
-	    << "Ctype " << ctype
-	    << " computed for character "
-	    << pgraphic ( c )
-	    << " is too large for"
-	       " dispatcher "
-	    << pID ( dispatcher_ID,
-		     program )
-	    << min::eol;
-	return LEX::SCAN_ERROR;
-    }
-
-    return ctype;
-}
-
+// scan_atom<checked,traced,mode> is specialized on
+// whether checks made by verify_program are done, on
+// whether the scanner is tracing or profiling at all,
+// so that with both off it contains no tracing or
+// profiling code (the individual trace bits are tested
+// at run time), and on the input mode (see input_mode
+// above), so the input is read without testing
+// scanner->compact_input or byte_input for each
+// character.  See scan_atom_functions below.
+//
+template < bool checked, bool traced,
+	   input_mode mode >
 static uns32 scan_atom
     ( LEX::scanner scanner,
       uns32 return_stack[LEX::return_stack_size],
       uns32 & return_stack_p,
       uns32 & atom_length )
 {
+    if ( mode == BYTE_INPUT && ! scanner->byte_input )
+        return scan_atom<checked,traced,CHAR_INPUT>
+	    ( scanner, return_stack, return_stack_p,
+	      atom_length );
+
     LEX::program program =
         scanner->program;
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
     LEX::translation_buffer translation_buffer =
         scanner->translation_buffer;
 
     const uns32 SCAN_ERROR = 0;
         // Local version of SCAN_ERROR.
 
-    if ( scanner->trace & LEX::TRACE_TABLE )
+    const uns32 trace =
+        ! traced ? 0 :
+	    ( scanner->trace & ~ PROFILE_FLAG )
+	  | ( ::is_profiling ( scanner, program ) ?
+	      PROFILE_FLAG : 0 );
+	// 0 unless traced, so the compiler can
+	// remove tracing and profiling code.
+
+    if ( trace & LEX::TRACE_TABLE )
         scanner->printer
 	    << "Start atom scan: table = "
 	    << pID ( scanner->current_table_ID,
 	             program )
 	    << min::eol;
-    bool trace_dispatch =
-        ( scanner->trace & LEX::TRACE_DISPATCH );
+    const bool trace_dispatch =
+        ( ( trace & LEX::TRACE_DISPATCH ) != 0 );
+    const bool profile =
+        ( ( trace & PROFILE_FLAG ) != 0 );
+    const bool interpret = trace_dispatch || profile;
+	// If true, dispatch with the program
+	// dispatchers rather than compiled or flat
+	// dispatch.
+    LEX::profile counts = scanner->profile;
+    uns32 table_ID = scanner->current_table_ID;
+    clock_t start_time = 0;
+    if ( profile )
+    {
+        ::profile_count ( counts, table_ID );
+	if ( scanner->profile_time )
+	    start_time = clock();
+    }
 
     min::ptr<table_header> cathp =
 	LEX::ptr<table_header>
@@ -1317,20 +4039,152 @@ static uns32 scan_atom
 	// Save of current translation buffer position
 	// for REQUIRE and ELSE.
 
-    MIN_ASSERT ( instruction_ID == 0
-	         ||
-		    program[instruction_ID]
-	         == INSTRUCTION,
-                 "non-zero instruction_ID argument"
-		 " does NOT identify an instruction" );
-    MIN_ASSERT ( dispatcher_ID == 0
-	         ||
-		    program[dispatcher_ID]
-	         == DISPATCHER,
-                 "non-zero dispatcher_ID argument"
-		 " does NOT identify an dispatcher" );
+    if ( checked )
+    {
+	MIN_ASSERT ( instruction_ID == 0
+		     ||
+			program[instruction_ID]
+		     == INSTRUCTION,
+		     "non-zero instruction_ID argument"
+		     " does NOT identify an"
+		     " instruction" );
+	MIN_ASSERT ( dispatcher_ID == 0
+		     ||
+			program[dispatcher_ID]
+		     == DISPATCHER,
+		     "non-zero dispatcher_ID argument"
+		     " does NOT identify an"
+		     " dispatcher" );
+    }
 
-    while ( true )
+    const bool compiled =
+           scanner->compiled != NULL
+        &&
+	   ( mode == BUFFER_INPUT
+	     ||
+	     ( mode == ANY_INPUT
+	       &&
+	       ! scanner->compact_input ) )
+        &&
+	   ! interpret;
+	// If true, use the compiled program.
+
+    if ( compiled )
+    {
+	// Compiled dispatch code does exactly what the
+	// following loop does, but without tracing.
+	//
+	if ( dispatcher_ID != 0 )
+	    (*scanner->compiled->dispatch)
+		( dispatcher_ID, instruction_ID,
+		  atom_length, length, scanner );
+    }
+    else if ( scanner->flat_states != NULL_STUB
+              &&
+	      scanner->flat_states->length > 0
+              &&
+	      ! interpret )
+    {
+	// Flattened dispatch does exactly what the
+	// following loop does, but without tracing.
+	//
+	LEX::flat_states states = scanner->flat_states;
+	LEX::flat_transitions transitions =
+	    scanner->flat_transitions;
+	LEX::flat_ascii ascii = scanner->flat_ascii;
+
+	uns32 state =
+	    ( dispatcher_ID == 0 ? 0 :
+	      ::flat_state_of ( states, dispatcher_ID ) );
+	while ( state != 0 )
+	{
+	    if (    scanner->next + length
+		 >= ::mode_length<mode> ( scanner ) )
+	    {
+		if ( ! (*scanner->input->get)
+			   ( scanner, scanner->input ) )
+		    break; // End of file.
+		if ( mode == BYTE_INPUT
+		     &&
+		     ! scanner->byte_input )
+		    return scan_atom
+			       <checked,traced,CHAR_INPUT>
+			( scanner, return_stack,
+			  return_stack_p, atom_length );
+	    }
+
+	    uns32 i = scanner->next + length;
+	    ++ length;
+
+	    Uchar c = ::mode_character<mode>
+		( scanner, i );
+	    uns32 tindex =
+		( mode == BYTE_INPUT || c < 128 ?
+		  ascii[128*state + c] :
+		  ::flat_transition_index
+		      ( program, & states[state],
+			c ) );
+	    min::ptr<LEX::flat_transition> tp =
+	        & transitions[tindex];
+
+	    uns32 count = tp->repeat_count;
+	    while ( count != 0 )
+	    {
+		// Skip the run of ASCII characters
+		// already in the input buffer quickly,
+		// and then do the next character the
+		// slow way.
+		//
+		uns32 n = ::flat_ascii_run<mode>
+		    ( scanner,
+		      scanner->next + length,
+		      ~ & ascii[128*state],
+		      tindex, count );
+		length += n;
+		count -= n;
+		if ( count == 0 ) break;
+
+		if (    scanner->next + length
+		     >= ::mode_length<mode> ( scanner ) )
+		{
+		    if ( ! (*scanner->input->get)
+			       ( scanner, scanner->input ) )
+			break; // End of file.
+		    if ( mode == BYTE_INPUT
+			 &&
+			 ! scanner->byte_input )
+			return scan_atom
+				   <checked,traced,CHAR_INPUT>
+			    ( scanner, return_stack,
+			      return_stack_p, atom_length );
+		}
+
+		Uchar c = ::mode_character<mode>
+		    ( scanner, scanner->next + length );
+
+		// Same transition means same ctype.
+		//
+		uns32 tindex2 =
+		    ( mode == BYTE_INPUT || c < 128 ?
+		      ascii[128*state + c] :
+		      ::flat_transition_index
+			  ( program, & states[state],
+			    c ) );
+		if ( tindex2 != tindex ) break;
+
+		++ length;
+		-- count;
+	    }
+
+	    if ( tp->instruction_ID != 0 )
+	    {
+		instruction_ID = tp->instruction_ID;
+		atom_length = length;
+	    }
+	    state = tp->next_state;
+	}
+    }
+    else while ( true )
     {
 	// Dispatch the next character.  Stop when
 	// we have no next dispatcher or no next
@@ -1339,29 +4193,40 @@ static uns32 scan_atom
 	if ( dispatcher_ID == 0 ) break;
 
 	if (    scanner->next + length
-	     >= input_buffer->length
-	     &&
-	     ! (*scanner->input->get)
-	         ( scanner, scanner->input ) )
-	    break; // End of file.
-
-	MIN_REQUIRE
-	    (   scanner->next + length
-	      < input_buffer->length );
-	Uchar c =
-	    (&input_buffer[scanner->next + length])
-	                ->character;
+	     >= ::mode_length<mode> ( scanner ) )
+	{
+	    if ( ! (*scanner->input->get)
+		       ( scanner, scanner->input ) )
+		break; // End of file.
+	    if ( mode == BYTE_INPUT
+		 &&
+		 ! scanner->byte_input )
+		return scan_atom
+			   <checked,traced,CHAR_INPUT>
+		    ( scanner, return_stack,
+		      return_stack_p, atom_length );
+	}
+
+	if ( checked )
+	    MIN_REQUIRE
+		(   scanner->next + length
+		  < ::mode_length<mode> ( scanner ) );
+	Uchar c = ::mode_character<mode>
+	    ( scanner, scanner->next + length );
 	++ length;
 
 	min::ptr<dispatcher_header> dhp =
 	    LEX::ptr<dispatcher_header>
 	        ( program, dispatcher_ID );
 
-	uns32 ctype = get_ctype
+	uns32 ctype = get_ctype<checked,traced>
 	    ( c, scanner, program, dispatcher_ID, dhp,
 	      length, trace_dispatch, "" );
 	if ( ctype == LEX::SCAN_ERROR )
 	    return SCAN_ERROR;
+	if ( profile )
+	    ::profile_dispatch
+	        ( counts, dispatcher_ID, ctype );
 
 	min::ptr<map_element> mep =
 	    LEX::ptr<map_element>
@@ -1373,27 +4238,40 @@ static uns32 scan_atom
 	if ( count != 0 ) while ( count -- )
 	{
 	    if (    scanner->next + length
-		 >= input_buffer->length
-		 &&
-		 ! (*scanner->input->get)
-		     ( scanner, scanner->input ) )
-		break; // End of file.
+		 >= ::mode_length<mode> ( scanner ) )
+	    {
+		if ( ! (*scanner->input->get)
+			   ( scanner, scanner->input ) )
+		    break; // End of file.
+		if ( mode == BYTE_INPUT
+		     &&
+		     ! scanner->byte_input )
+		    return scan_atom
+			       <checked,traced,CHAR_INPUT>
+			( scanner, return_stack,
+			  return_stack_p, atom_length );
+	    }
 
-	    MIN_REQUIRE
-		(   scanner->next + length
-		  < input_buffer->length );
+	    if ( checked )
+		MIN_REQUIRE
+		    (   scanner->next + length
+		      < ::mode_length<mode> ( scanner ) );
 
-	    c = (&input_buffer[scanner->next + length])
-			    ->character;
+	    c = ::mode_character<mode>
+		( scanner, scanner->next + length );
 
-	    uns32 ctype2 = get_ctype
-		( c, scanner, program, dispatcher_ID,
-		  dhp, length, trace_dispatch,
-		  "Repeat " );
-	    if ( ctype == LEX::SCAN_ERROR )
+	    uns32 ctype2 =
+	        get_ctype<checked,traced>
+		    ( c, scanner, program, dispatcher_ID,
+		      dhp, length, trace_dispatch,
+		      "Repeat " );
+	    if ( ctype2 == LEX::SCAN_ERROR )
 	        return SCAN_ERROR;
 
 	    if ( ctype2 != ctype ) break;
+	    if ( profile )
+		::profile_dispatch
+		    ( counts, dispatcher_ID, ctype );
 
 	    ++ length;
 	}
@@ -1407,19 +4285,35 @@ static uns32 scan_atom
 	{
 	    instruction_ID =
 	        (&mep[ctype])->instruction_ID;
-	    MIN_REQUIRE (    program[instruction_ID]
-		          == INSTRUCTION );
+	    if ( checked )
+		MIN_REQUIRE (    program[instruction_ID]
+			      == INSTRUCTION );
 	    atom_length = length;
 	}
 	dispatcher_ID = (&mep[ctype])->dispatcher_ID;
-	MIN_REQUIRE ( dispatcher_ID == 0
-		      ||
-		         program[dispatcher_ID]
-		      == DISPATCHER );
+	if ( checked )
+	    MIN_REQUIRE ( dispatcher_ID == 0
+			  ||
+			     program[dispatcher_ID]
+			  == DISPATCHER );
     }
 
     // We are done dispatching characters.
 
+    // Compiled instruction code does exactly what the
+    // following loop does for the instructions it
+    // compiles, but without tracing.
+    //
+    if ( compiled
+         &&
+	 trace == 0
+	 &&
+	 instruction_ID != 0
+	 &&
+	 (*scanner->compiled->execute)
+	     ( instruction_ID, atom_length, scanner ) )
+	return instruction_ID;
+
     // Loop to process instruction group.
     //
     while ( true )
@@ -1435,10 +4329,12 @@ static uns32 scan_atom
 	    return SCAN_ERROR;
 	}
 
-	if ( scanner->trace & LEX::TRACE_INSTRUCTION )
+	if ( trace & LEX::TRACE_INSTRUCTION )
 	    print_instruction
 	        ( scanner->printer << "  ",
 		  program, instruction_ID );
+	if ( profile )
+	    ::profile_count ( counts, instruction_ID );
 
 	bool fail = false;
 
@@ -1453,13 +4349,31 @@ static uns32 scan_atom
 	    // no-oping the instruction for the sake
 	    // of an ELSE.
 
+	if ( scanner->translation_is_identity
+	     &&
+	     ( op & (   MATCH
+	              | TRANSLATE_TO_FLAG
+		      | TRANSLATE_HEX_FLAG
+		      | TRANSLATE_OCT_FLAG
+		      | TRANSLATE_NAME_FLAG
+		      | REQUIRE ) ) )
+	{
+	    // The translation is about to differ from
+	    // the input, so fill in the translation of
+	    // the lexeme so far.
+	    //
+	    LEX::expand_translation ( scanner );
+	    tnext = translation_buffer->length;
+	}
+
 	if ( op & MATCH )
 	{
 	    min::ptr<table_header> thp =
 		LEX::ptr<table_header>
 		    ( program, ihp->atom_table_ID );
-	    MIN_REQUIRE ( cathp->pctype == TABLE );
-	    if ( thp->mode != ATOM )
+	    if ( checked )
+		MIN_REQUIRE ( thp->pctype == TABLE );
+	    if ( checked && thp->mode != ATOM )
 	    {
 		scan_error ( scanner, atom_length )
 		    << "MATCH in instruction "
@@ -1506,13 +4420,60 @@ static uns32 scan_atom
 		return SCAN_ERROR;
 	    }
 
-	    scanner->current_table_ID =
-	        ihp->atom_table_ID;
-	    uns32 tinstruction_ID =
-	        scan_atom ( scanner,
-		            return_stack,
-			    return_stack_p,
-			    keep_length );
+	    uns32 memo_index = 0;
+	    if ( scanner->memo )
+	    {
+		if ( profile )
+		    ::profile_count
+		        ( counts, instruction_ID + 2 );
+		memo_index = ::memo_find
+		    ( scanner, ihp->atom_table_ID );
+	    }
+
+	    uns32 tinstruction_ID;
+	    if ( memo_index != 0 )
+	    {
+		min::ptr<LEX::memo_entry> mp =
+		    & scanner->memo_table[memo_index-1];
+		tinstruction_ID = mp->result;
+		if ( mp->translation_length > 0 )
+		    min::push
+			( translation_buffer,
+			  mp->translation_length,
+			  min::ptr<const Uchar>
+			      ( & scanner->memo_translations
+				      [mp->translation_first] ) );
+		keep_length = mp->length;
+
+		if ( profile )
+		    ::profile_count
+		        ( counts, instruction_ID + 3 );
+	    }
+	    else
+	    {
+		uns32 erroneous_atom_count =
+		    scanner->erroneous_atom_count;
+
+		scanner->current_table_ID =
+		    ihp->atom_table_ID;
+		tinstruction_ID =
+		    scan_atom<checked,traced,mode>
+			      ( scanner,
+				return_stack,
+				return_stack_p,
+				keep_length );
+
+		if ( scanner->memo
+		     &&
+		     tinstruction_ID != 0
+		     &&
+		        erroneous_atom_count
+		     == scanner->erroneous_atom_count )
+		    ::memo_store
+		        ( scanner, ihp->atom_table_ID,
+			  tinstruction_ID, keep_length,
+			  tnext );
+	    }
 
 	    scanner->current_table_ID =
 		return_stack[--return_stack_p];
@@ -1547,7 +4508,7 @@ static uns32 scan_atom
 		    }
 		    tc <<= 4;
 		    Uchar d =
-			(&input_buffer[p++])->character;
+			LEX::input_character ( scanner, p++ );
 		    if ( '0' <= d && d <= '9' )
 			tc += d - '0';
 		    else if ( 'a' <= d && d <= 'f' )
@@ -1570,7 +4531,7 @@ static uns32 scan_atom
 		    }
 		    tc <<= 3;
 		    Uchar d =
-			(&input_buffer[p++])->character;
+			LEX::input_character ( scanner, p++ );
 		    if ( '0' <= d && d <= '7' )
 			tc += d - '0';
 		    else
@@ -1598,8 +4559,8 @@ static uns32 scan_atom
 		char * np = name;
 		while ( p < endp )
 		    min::unicode_to_utf8
-		        ( np, (&input_buffer[p++])
-			          ->character );
+		        ( np, LEX::input_character
+			          ( scanner, p++ ) );
 		* np = 0;
 		tc = min::find
 		        ( LEX::character_name_table,
@@ -1614,10 +4575,37 @@ static uns32 scan_atom
 
 	if ( ! fail && ( op & REQUIRE ) )
 	{
+	    // The translation being checked is deter-
+	    // mined by the instruction, the input off-
+	    // set, and the atom length, so these are
+	    // the memo key.
+	    //
+	    bool memo_hit = false;
+	    if ( scanner->memo )
+	    {
+		if ( profile )
+		    ::profile_count
+		        ( counts, instruction_ID + 4 );
+		uns32 memo_index = ::memo_find
+		    ( scanner, instruction_ID,
+		      keep_length );
+		if ( memo_index != 0 )
+		{
+		    memo_hit = true;
+		    fail = (    (&scanner->memo_table
+		                       [memo_index-1])
+				    ->result
+			     != 0 );
+		    if ( profile )
+			::profile_count
+			    ( counts, instruction_ID + 5 );
+		}
+	    }
+
 	    uns32 dispatcher_ID =
 		ihp->require_dispatcher_ID;
 	    uns32 tlength = 0;
-	    while ( true )
+	    while ( ! memo_hit )
 	    {
 		// Dispatch the next translate_buffer
 		// character.  Stop with if we have
@@ -1631,8 +4619,10 @@ static uns32 scan_atom
 				    ->length );
 		    break;
 		}
-		MIN_REQUIRE (    program[dispatcher_ID]
-			      == DISPATCHER );
+		if ( checked )
+		    MIN_REQUIRE
+		        (    program[dispatcher_ID]
+			  == DISPATCHER );
 
 		if (    tnext + tlength
 		     >= translation_buffer->length )
@@ -1649,13 +4639,16 @@ static uns32 scan_atom
 		    LEX::ptr<dispatcher_header>
 		        ( program, dispatcher_ID );
 
-		uns32 ctype = get_ctype
-		    ( c, scanner, program,
-		      dispatcher_ID, dhp,
-		      length, trace_dispatch,
-		      "Require " );
+		uns32 ctype =
+		    get_ctype<checked,traced>
+			( c, scanner, program,
+			  dispatcher_ID, dhp, length,
+			  trace_dispatch, "Require " );
 		if ( ctype == LEX::SCAN_ERROR )
 		    return SCAN_ERROR;
+		if ( profile )
+		    ::profile_dispatch
+			( counts, dispatcher_ID, ctype );
 
 		if ( ctype == 0 )
 		{
@@ -1674,10 +4667,19 @@ static uns32 scan_atom
 		dispatcher_ID =
 		    (&mep[ctype])->dispatcher_ID;
 	    }
+
+	    if ( scanner->memo && ! memo_hit )
+		::memo_store
+		    ( scanner, instruction_ID,
+		      fail ? 1 : 0, keep_length,
+		      translation_buffer->length );
 	}
 
 	if ( fail )
 	{
+	    if ( profile )
+		::profile_count
+		    ( counts, instruction_ID + 1 );
 	    min::pop ( translation_buffer,
 		         translation_buffer->length
 		       - tnext );
@@ -1699,8 +4701,10 @@ static uns32 scan_atom
 			<< min::eol;
 		    return SCAN_ERROR;
 		}
-		MIN_REQUIRE (    program[instruction_ID]
-			      == INSTRUCTION );
+		if ( checked )
+		    MIN_REQUIRE
+		        (    program[instruction_ID]
+			  == INSTRUCTION );
 
 		// Loop to next instruction.
 		//
@@ -1738,6 +4742,30 @@ static uns32 scan_atom
 	    atom_length = keep;
 	}
 
+	if ( op & SKIP_TO )
+	{
+	    uns32 skip_to_ID =
+	        instruction_ID + instruction_header_length;
+	    if ( op & TRANSLATE_TO_FLAG )
+	        skip_to_ID +=
+		    LEX::translate_to_length ( op );
+	    ::skip_to_set set ( program, skip_to_ID );
+	    while ( true )
+	    {
+		atom_length += ::skip_to_run<mode>
+		    ( scanner,
+		      scanner->next + atom_length, set );
+		if (    scanner->next + atom_length
+		     < ( mode == BYTE_INPUT ?
+		         LEX::input_length ( scanner ) :
+		         ::mode_length<mode> ( scanner ) ) )
+		    break; // At delimiter.
+		if ( ! (*scanner->input->get)
+			   ( scanner, scanner->input ) )
+		    break; // End of file.
+	    }
+	}
+
 	if ( op & TRANSLATE_TO_FLAG )
 	{
 	    min::pop ( translation_buffer,
@@ -1755,12 +4783,23 @@ static uns32 scan_atom
 	else if ( ! ( op & (   MATCH
 	                     | TRANSLATE_HEX_FLAG
 	                     | TRANSLATE_NAME_FLAG
-	                     | TRANSLATE_OCT_FLAG ) ) )
+	                     | TRANSLATE_OCT_FLAG ) )
+	          &&
+		  ! scanner->translation_is_identity )
 	{
 	    uns32 p = scanner->next;
-	    for ( uns32 i = 0; i < atom_length; ++ i )
-		min::push(translation_buffer) =
-		    (&input_buffer[p++])->character;
+	    if ( mode == BYTE_INPUT
+	         &&
+		 ! scanner->byte_input )
+		for ( uns32 i = 0; i < atom_length; ++ i )
+		    min::push(translation_buffer) =
+			::mode_character<CHAR_INPUT>
+			    ( scanner, p++ );
+	    else
+		for ( uns32 i = 0; i < atom_length; ++ i )
+		    min::push(translation_buffer) =
+			::mode_character<mode>
+			    ( scanner, p++ );
 	}
 
 	if ( op & ERRONEOUS_ATOM )
@@ -1781,6 +4820,7 @@ static uns32 scan_atom
 	    }
 	    else
 	    {
+		++ scanner->erroneous_atom_count;
 		(*scanner->erroneous_atom->announce)
 		    ( scanner->next,
 		      scanner->next + atom_length,
@@ -1790,94 +4830,227 @@ static uns32 scan_atom
 	    }
 	}
 
+	if ( profile )
+	{
+	    ::profile_count
+	        ( counts, table_ID + 1, atom_length );
+	    if ( scanner->profile_time )
+		::profile_count
+		    ( counts, table_ID + 2,
+		      clock() - start_time );
+	}
+
 	return instruction_ID;
     }
     abort();
 }
 
-uns32 LEX::scan ( uns32 & first, uns32 & next,
-                  LEX::scanner scanner )
+// scan_atom_functions[checked][mode] is scan_atom<
+// checked,traced,mode>, where the mode is ANY_INPUT
+// and traced is true if scanner->trace != 0 or the
+// scanner is profiling, and otherwise traced is false
+// and the mode is that of the scanner input when the
+// scan begins.
+//
+typedef uns32 ( * scan_atom_function )
+    ( LEX::scanner scanner,
+      uns32 return_stack[LEX::return_stack_size],
+      uns32 & return_stack_p,
+      uns32 & atom_length );
+
+static const scan_atom_function
+    scan_atom_functions[2][4] =
+        { { scan_atom<false,true,ANY_INPUT>,
+	    scan_atom<false,false,BUFFER_INPUT>,
+	    scan_atom<false,false,CHAR_INPUT>,
+	    scan_atom<false,false,BYTE_INPUT> },
+	  { scan_atom<true,true,ANY_INPUT>,
+	    scan_atom<true,false,BUFFER_INPUT>,
+	    scan_atom<true,false,CHAR_INPUT>,
+	    scan_atom<true,false,BYTE_INPUT> } };
+
+// Reinitialize the scanner as per scanner->reinitialize.
+// Return false with a message in min::error_message on
+// error.
+//
+static bool reinitialize_scanner
+	( LEX::scanner scanner )
 {
-    if ( scanner->reinitialize )
+    if ( scanner->input == NULL_STUB )
+        input_ref(scanner) = default_input;
+
+    if ( scanner->erroneous_atom == NULL_STUB )
+        erroneous_atom_ref(scanner) =
+            default_erroneous_atom;
+
+    if ( scanner->program == NULL_STUB )
+    {
+        min::init ( min::error_message )
+            << "LEXICAL SCANNER ERROR: no program"
+	    << min::eol;
+        return false;
+    }
+    else if ( scanner->program[0] != PROGRAM )
+    {
+        min::init ( min::error_message )
+            << "LEXICAL SCANNER ERROR:"
+	       " illegal program"
+	    << min::eol;
+        return false;
+    }
+    else if (   scanner->initial_table
+              > LEXDATA::max_master
+		    ( scanner->program) )
     {
-        if ( scanner->input == NULL_STUB )
-	    input_ref(scanner) = default_input;
+        min::init ( min::error_message )
+            << "LEXICAL SCANNER ERROR:"
+	       " initial_table >"
+	       " max_master ( program )"
+	    << min::eol;
+        return false;
+    }
 
-        if ( scanner->erroneous_atom == NULL_STUB )
-	    erroneous_atom_ref(scanner) =
-	        default_erroneous_atom;
+    scanner->current_table_ID =
+        * LEXDATA::master_ID_ptr
+            ( scanner->program,
+	      scanner->initial_table );
 
-	if ( scanner->program == NULL_STUB )
-	{
-	    min::init ( min::error_message )
-	        << "LEXICAL SCANNER ERROR: no program"
-		<< min::eol;
-	    return SCAN_ERROR;
-	}
-	else if ( scanner->program[0] != PROGRAM )
-	{
-	    min::init ( min::error_message )
-	        << "LEXICAL SCANNER ERROR:"
-		   " illegal program"
-		<< min::eol;
-	    return SCAN_ERROR;
-	}
-	else if (   scanner->initial_table
-	          > LEXDATA::max_master
-		        ( scanner->program) )
-	{
-	    min::init ( min::error_message )
-	        << "LEXICAL SCANNER ERROR:"
-		   " initial_table >"
-		   " max_master ( program )"
-		<< min::eol;
-	    return SCAN_ERROR;
-	}
+    if ( scanner->current_table_ID == 0 )
+    {
+        min::init ( min::error_message )
+            << "LEXICAL SCANNER ERROR:"
+	       " initial_table "
+	    << scanner->initial_table
+	    << " is undefined"
+	    << min::eol;
+        return false;
+    }
 
-	scanner->current_table_ID =
-	    * LEXDATA::master_ID_ptr
-	        ( scanner->program,
-		  scanner->initial_table );
+    if ( scanner->input_file == NULL_STUB )
+    {
+        init_input_stream
+            ( input_file_ref(scanner), std::cin );
+        init_file_name
+            ( input_file_ref(scanner),
+	      min::new_str_gen
+		  ( "standard input" ) );
+    }
 
-	if ( scanner->current_table_ID == 0 )
-	{
-	    min::init ( min::error_message )
-	        << "LEXICAL SCANNER ERROR:"
-		   " initial_table "
-		<< scanner->initial_table
-		<< " is undefined"
-		<< min::eol;
-	    return SCAN_ERROR;
-	}
+    if ( scanner->compact_input
+         &&
+         scanner->input_chars == NULL_STUB )
+    {
+        LEX::input_chars_ref(scanner) =
+	    Uchar_vec_type.new_gen();
+        LEX::input_lines_ref(scanner) =
+	    input_line_vec_type.new_gen();
+        LEX::input_offsets_ref(scanner) =
+	    uns32_vec_type.new_gen();
+    }
+    if ( scanner->index_lines
+         &&
+         scanner->line_deltas == NULL_STUB )
+    {
+        LEX::line_bases_ref(scanner) =
+	    uns64_vec_type.new_gen();
+        LEX::line_deltas_ref(scanner) =
+	    uns32_vec_type.new_gen();
+    }
+    if ( scanner->compact_input
+         &&
+         scanner->ascii_input
+         &&
+         scanner->input_bytes == NULL_STUB )
+        LEX::input_bytes_ref(scanner) =
+	    uns8_vec_type.new_gen();
+    if ( scanner->compact_input )
+    {
+        // The input is empty here.
+        //
+        MIN_REQUIRE
+            ( LEX::input_length ( scanner ) == 0 );
+        scanner->byte_input = scanner->ascii_input;
+    }
 
-	if ( scanner->input_file == NULL_STUB )
-	{
-	    init_input_stream
-	        ( input_file_ref(scanner), std::cin );
-	    init_file_name
-	        ( input_file_ref(scanner),
-		  min::new_str_gen
-		      ( "standard input" ) );
-	}
+    scanner->next_position.line = 0;
+    scanner->next_position.offset = 0;
+    scanner->next_indent = 0;
+    scanner->scan_error = false;
+    scanner->next = 0;
+    ::memo_clear ( scanner );
+    scanner->translation_is_identity = false;
 
-	scanner->next_position.line = 0;
-	scanner->next_position.offset = 0;
-	scanner->next_indent = 0;
-        scanner->scan_error = false;
-        scanner->next = 0;
+    scanner->reinitialize = false;
 
-        scanner->reinitialize = false;
+    min::ptr<table_header> cathp =
+        LEX::ptr<table_header>
+	    ( scanner->program,
+	      scanner->current_table_ID );
+    MIN_REQUIRE ( cathp->pctype == TABLE );
+    MIN_REQUIRE ( cathp->mode == MASTER );
+    return true;
+}
 
-	min::ptr<table_header> cathp =
-	    LEX::ptr<table_header>
-		( scanner->program,
-		  scanner->current_table_ID );
-	MIN_REQUIRE ( cathp->pctype == TABLE );
-	MIN_REQUIRE ( cathp->mode == MASTER );
-    }
+// Push a checkpoint if a scan beginning at scanner->
+// next is at the beginning of a line after that of the
+// last checkpoint.  See scanner->checkpoints.
+//
+// As lines are decoded whole with a line feed added
+// at their ends, a scan is at a line beginning if the
+// input is used up and next_position.offset is 0, or
+// if the character before scanner->next is a line
+// feed, so the position is only computed at line
+// beginnings.  Next is 0 with input only just after
+// initialization, when it is computed anyway.
+//
+inline void record_checkpoint ( LEX::scanner scanner )
+{
+    uns32 next = scanner->next;
+    min::position position;
+    if ( next >= LEX::input_length ( scanner ) )
+        position = scanner->next_position;
+    else if ( next == 0
+              ||
+                 LEX::input_character
+		     ( scanner, next - 1 )
+	      == '\n' )
+        position = LEX::input_position
+	    ( scanner, next );
+    else
+        return;
+    if ( position.offset != 0 ) return;
+
+    LEX::checkpoints checkpoints = scanner->checkpoints;
+    uns32 n = checkpoints->length;
+    if ( n > 0
+         &&
+	 (&checkpoints[n-1])->line >= position.line )
+        return;
+
+    LEX::checkpoint c;
+    c.line = position.line;
+    c.table_ID = scanner->current_table_ID;
+    min::push(checkpoints) = c;
+}
+
+// LEX::scan, but if shift is false the input buffer
+// is not shifted down, so input buffer offsets
+// returned by previous calls remain valid.
+//
+static uns32 scan_lexeme
+	( uns32 & first, uns32 & next,
+	  LEX::scanner scanner, bool shift )
+{
+    if ( scanner->reinitialize
+         &&
+	 ! ::reinitialize_scanner ( scanner ) )
+	return SCAN_ERROR;
 
     MIN_REQUIRE ( scanner->scan_error == false );
 
+    if ( scanner->checkpoints != NULL_STUB )
+        ::record_checkpoint ( scanner );
+
     if (    scanner->trace != 0
 	 && scanner->printer == NULL_STUB )
 	min::init ( LEX::printer_ref(scanner) );
@@ -1889,7 +5062,11 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
     LEX::translation_buffer translation_buffer =
         scanner->translation_buffer;
 
-    if (    scanner->next
+    if ( shift
+         &&
+	 ! scanner->compact_input
+	 &&
+            scanner->next
          >= inchar_vec_type.max_increment )
     {
         // If next has gotten to be as large as
@@ -1904,6 +5081,22 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 		  * sizeof ( LEX::inchar ) );
 	min::pop ( input_buffer, scanner->next );
 	scanner->next = 0;
+	::memo_clear ( scanner );
+    }
+    else if ( shift
+              &&
+	      scanner->compact_input
+	      &&
+                 scanner->next
+              >= ( scanner->byte_input ?
+	           uns8_vec_type.max_increment :
+	           Uchar_vec_type.max_increment ) )
+    {
+        // Ditto for compact input.
+	//
+	::compact_shift ( scanner, scanner->next );
+	scanner->next = 0;
+	::memo_clear ( scanner );
     }
 
     // We scan atoms until we get to a point where the
@@ -1926,6 +5119,22 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
     // to zero we must be in a loop changing tables and
     // not finding an atom.
     // 
+    bool checked =
+        ( scanner->checked || ! scanner->verified );
+	// If false, omit checks made by verify_
+	// program.
+    scan_atom_function scan_atom_f =
+        scan_atom_functions
+	    [checked]
+	    [   scanner->trace != 0
+	     || ::is_profiling ( scanner, program ) ?
+	        ANY_INPUT :
+	     ! scanner->compact_input ?
+	        BUFFER_INPUT :
+	     scanner->byte_input ?
+	        BYTE_INPUT :
+		CHAR_INPUT];
+	// Specialized once per call.
     uns32 lexeme_type = NONE;
     uns32 loop_count = program->length;
         // Set to max number of tables in order to
@@ -1944,7 +5153,8 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 		( program,
 		  scanner->current_table_ID );
 
-	MIN_REQUIRE ( cathp->mode != ATOM );
+	if ( checked )
+	    MIN_REQUIRE ( cathp->mode != ATOM );
 
 	if ( cathp->mode == MASTER )
 	{
@@ -1954,6 +5164,9 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 	    first = scanner->next;
 	    min::pop ( translation_buffer,
 		       translation_buffer->length );
+	    scanner->lexeme_first = first;
+	    scanner->translation_is_identity =
+	        scanner->lazy_translation;
 
 	    return_stack_p = 0;
 	}
@@ -1966,10 +5179,10 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 	uns32 atom_length;
 
 	uns32 instruction_ID =
-	    scan_atom ( scanner,
-	                return_stack,
-			return_stack_p,
-			atom_length );
+	    (*scan_atom_f) ( scanner,
+	                     return_stack,
+			     return_stack_p,
+			     atom_length );
 
 	if ( instruction_ID == 0 )
 	    return SCAN_ERROR;
@@ -1999,9 +5212,11 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 	    }
 	    scanner->current_table_ID =
 		return_stack[--return_stack_p];
-	    MIN_REQUIRE
-	        (    program[scanner->current_table_ID]
-		  == TABLE );
+	    if ( checked )
+		MIN_REQUIRE
+		    (    program
+		             [scanner->current_table_ID]
+		      == TABLE );
 	}
 	else if ( op & GOTO )
 	{
@@ -2011,8 +5226,9 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 		LEX::ptr<table_header>
 		    ( program,
 		      scanner->current_table_ID );
-	    MIN_REQUIRE ( cathp->pctype == TABLE );
-	    if ( cathp->mode == ATOM )
+	    if ( checked )
+		MIN_REQUIRE ( cathp->pctype == TABLE );
+	    if ( checked && cathp->mode == ATOM )
 
 	    {
 		scan_error ( scanner, atom_length )
@@ -2071,10 +5287,13 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 		LEX::ptr<table_header>
 		    ( program,
 		      scanner->current_table_ID );
-	    MIN_REQUIRE ( cathp->pctype == TABLE );
-	    if ( cathp->mode == MASTER
-	         ||
-		 cathp->mode == ATOM )
+	    if ( checked )
+		MIN_REQUIRE ( cathp->pctype == TABLE );
+	    if ( checked
+	         &&
+		 ( cathp->mode == MASTER
+		   ||
+		   cathp->mode == ATOM ) )
 	    {
 		scan_error ( scanner, atom_length )
 		    << "CALL in instruction "
@@ -2091,6 +5310,7 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
 	if ( atom_length > 0 )
 	{
 	    scanner->next += atom_length;
+	    ::memo_clear ( scanner );
 	    loop_count = program->length;
 	}
 	else if ( -- loop_count == 0 )
@@ -2111,15 +5331,84 @@ uns32 LEX::scan ( uns32 & first, uns32 & next,
     case NONE:
     case SCAN_ERROR:
     {
-	scan_error ( scanner, next - first, first )
-	    << "Returning lexeme with bad type("
-	    << pmode ( scanner->program, lexeme_type )
-	    << ")" << min::eol;
-	return SCAN_ERROR;
+	scan_error ( scanner, next - first, first )
+	    << "Returning lexeme with bad type("
+	    << pmode ( scanner->program, lexeme_type )
+	    << ")" << min::eol;
+	return SCAN_ERROR;
+    }
+    }
+
+    return lexeme_type;
+}
+
+uns32 LEX::scan ( uns32 & first, uns32 & next,
+                  LEX::scanner scanner )
+{
+    return ::scan_lexeme ( first, next, scanner, true );
+}
+
+// Append the translation of the lexeme input[first ..
+// next-1] just scanned to translations, and return its
+// offset and length there.
+//
+static void append_translation
+	( uns32 first, uns32 next,
+	  LEX::scanner scanner,
+	  LEX::translation_buffer translations,
+	  uns32 & offset, uns32 & length )
+{
+    offset = translations->length;
+    if ( scanner->translation_is_identity )
+    {
+	length = next - first;
+	for ( uns32 i = first; i < next; ++ i )
+	    min::push(translations) =
+		LEX::input_character ( scanner, i );
     }
+    else
+    {
+	LEX::translation_buffer translation_buffer =
+	    scanner->translation_buffer;
+	length = translation_buffer->length;
+	if ( length > 0 )
+	    min::push ( translations, length,
+			min::ptr<const Uchar>
+			    ( & translation_buffer[0] ) );
     }
+}
 
-    return lexeme_type;
+uns32 LEX::scan_batch
+	( LEX::batch_lexeme * lexemes, uns32 n,
+	  LEX::translation_buffer translations,
+	  uns64 stop_types,
+	  LEX::scanner scanner )
+{
+    uns32 count = 0;
+    while ( count < n )
+    {
+	LEX::batch_lexeme & b = lexemes[count++];
+	b.type = ::scan_lexeme
+	    ( b.first, b.next, scanner, count == 1 );
+	if ( b.type == SCAN_ERROR )
+	{
+	    b.first = b.next = scanner->next;
+	    b.translation_offset = translations->length;
+	    b.translation_length = 0;
+	    break;
+	}
+
+	::append_translation
+	    ( b.first, b.next, scanner, translations,
+	      b.translation_offset,
+	      b.translation_length );
+
+	if ( b.type < 64
+	     &&
+	     ( stop_types & ( uns64 ( 1 ) << b.type ) ) )
+	    break;
+    }
+    return count;
 }
 
 // See documentation above.
@@ -2135,14 +5424,9 @@ static min::printer scan_error
 	             << pID ( scanner->current_table_ID,
 		              scanner->program );
     min::position position =
-	scanner->next < scanner->input_buffer->length ?
-	    (min::position)
-	        scanner->input_buffer[next] :
-	    scanner->next_position;
+	LEX::input_position ( scanner, next );
     min::uns32 indent =
-	scanner->next < scanner->input_buffer->length ?
-	    (&scanner->input_buffer[next])->indent :
-	    scanner->next_indent;
+	LEX::input_indent ( scanner, next );
     min::error_message << ": position "
 	               << position.line << "("
 	               << position.offset << ")";
@@ -2201,6 +5485,782 @@ min::uns32 LEX::lexeme_type
         return min::int_of ( index );
 }
 
+// Parallel Scanning
+// -------- --------
+
+// Value returned by scan_chunks for a SCAN_ERROR, and
+// the stop_chunk of a worker that failed.
+//
+const uns32 BAD_CHUNK = 0xFFFFFFFF;
+
+// Erroneous atom closure used by workers and while
+// finding the seam table.  Erroneous atoms are just
+// counted, and are announced when their chunk is
+// rescanned by the calling process.
+//
+static void count_erroneous_atom
+	( uns32 first, uns32 next, uns32 type,
+	  LEX::scanner scanner,
+	  LEX::erroneous_atom erroneous_atom )
+{
+    ++ erroneous_atom->count;
+}
+
+// Set line_offsets to the offsets of the lines of the
+// mapped file or span text input of the scanner.
+//
+static void find_line_offsets
+	( LEX::scanner scanner,
+	  std::vector<uns64> & line_offsets )
+{
+    const char * data;
+    uns64 size;
+    if ( scanner->input == ::span_input )
+    {
+        size = scanner->span_text->length;
+	data = ( size == 0 ? NULL :
+	         ~ & scanner->span_text[0] );
+    }
+    else
+    {
+	MIN_REQUIRE ( scanner->mapped_data != NULL );
+        size = scanner->mapped_size;
+	data = scanner->mapped_data;
+    }
+
+    line_offsets.clear();
+    for ( uns64 next = 0; next < size; )
+    {
+        line_offsets.push_back ( next );
+	const char * p = (const char *)
+	    ::memchr ( data + next, '\n', size - next );
+	next = ( p == NULL ? size : p - data + 1 );
+    }
+}
+
+// Reinitialize the scanner and then put it at the
+// beginning of the given line, as if it had just
+// scanned a lexeme ending there, with table_ID as its
+// current table if that is not 0.  For mapped input
+// any previous lines not yet in scanner->input_file
+// are appended to it.  Return false on error as per
+// reinitialize_scanner.
+//
+static bool start_scanner_at
+	( min::ref<LEX::scanner> scanner,
+	  const std::vector<uns64> & line_offsets,
+	  uns32 line, uns32 table_ID )
+{
+    LEX::init ( scanner );
+    if ( ! ::reinitialize_scanner ( scanner ) )
+        return false;
+
+    bool span = ( scanner->input == ::span_input );
+    uns64 offset =
+        line < line_offsets.size() ?
+	line_offsets[line] :
+	span ? scanner->span_text->length :
+	       scanner->mapped_size;
+    if ( span )
+        scanner->span_next = (uns32) offset;
+    else
+    {
+	const char * data = scanner->mapped_data;
+	for ( uns32 k =
+	          scanner->input_file->next_line_number;
+	      k < line; ++ k )
+	{
+	    uns64 end = k + 1 < line_offsets.size() ?
+	                line_offsets[k + 1] :
+			scanner->mapped_size;
+	    bool add_eol = ( data[end - 1] == '\n' );
+	    ::spool_mapped_line
+	        ( scanner, data + line_offsets[k],
+		  end - line_offsets[k] - add_eol,
+		  add_eol );
+	}
+	scanner->mapped_next = offset;
+    }
+    scanner->next_position.line = line;
+    if ( table_ID != 0 )
+	scanner->current_table_ID = table_ID;
+    return true;
+}
+
+// Append a SCAN_ERROR lexeme at the given position to
+// lexemes as per scan_parallel.
+//
+static void push_scan_error
+	( min::position position,
+	  LEX::parallel_lexemes lexemes,
+	  LEX::translation_buffer translations )
+{
+    LEX::parallel_lexeme r;
+    r.type = SCAN_ERROR;
+    r.begin = r.end = position;
+    r.translation_offset = translations->length;
+    r.translation_length = 0;
+    min::push(lexemes) = r;
+}
+
+// Scan a lexeme and append it and its translation to
+// lexemes and translations.  Return its type, which
+// may be SCAN_ERROR.
+//
+static uns32 scan_record
+	( LEX::scanner scanner,
+	  LEX::parallel_lexemes lexemes,
+	  LEX::translation_buffer translations )
+{
+    uns32 first, next;
+    LEX::parallel_lexeme r;
+    r.type = ::scan_lexeme
+	( first, next, scanner, true );
+    if ( r.type == SCAN_ERROR )
+    {
+	::push_scan_error
+	    ( LEX::input_position
+		  ( scanner, scanner->next ),
+	      lexemes, translations );
+	return SCAN_ERROR;
+    }
+
+    r.begin = LEX::input_position ( scanner, first );
+    r.end = LEX::input_position ( scanner, next );
+    ::append_translation
+	( first, next, scanner, translations,
+	  r.translation_offset,
+	  r.translation_length );
+    min::push(lexemes) = r;
+    return r.type;
+}
+
+// Scan lexemes from the current scanner position,
+// which is the beginning of chunk k, and append them
+// and their translations to lexemes and translations.
+// Stop after the end of file lexeme and return the
+// number of chunks, or after a SCAN_ERROR (which is
+// appended as per scan_parallel) and return BAD_
+// CHUNK.  Or if stop is true, stop when the scanner
+// is between lexemes at the beginning of chunk j > k
+// with seam_table_ID as its current table, and return
+// j.
+//
+static uns32 scan_chunks
+	( LEX::scanner scanner,
+	  const std::vector<uns32> & chunk_lines,
+	  uns32 k, bool stop,
+	  uns32 seam_table_ID, uns32 end_of_file_t,
+	  LEX::parallel_lexemes lexemes,
+	  LEX::translation_buffer translations )
+{
+    uns32 chunks = chunk_lines.size();
+    uns32 j = k + 1;
+    while ( true )
+    {
+	uns32 type = ::scan_record
+	    ( scanner, lexemes, translations );
+	if ( type == SCAN_ERROR ) return ::BAD_CHUNK;
+	if ( type == end_of_file_t ) return chunks;
+	if ( ! stop ) continue;
+
+	min::position end =
+	    (&lexemes[lexemes->length-1])->end;
+	while ( j < chunks
+	        &&
+		chunk_lines[j] < end.line )
+	    ++ j;
+	if ( j < chunks
+	     &&
+	     end.line == chunk_lines[j]
+	     &&
+	     end.offset == 0
+	     &&
+	        scanner->current_table_ID
+	     == seam_table_ID )
+	    return j;
+    }
+}
+
+// Return the current table of the scanner when it is
+// first between lexemes at the beginning of a line
+// other than line 0, or 0 if it is not so by line
+// max_line.  Erroneous atoms are not announced.
+//
+static uns32 find_seam_table
+	( min::ref<LEX::scanner> scanner,
+	  const std::vector<uns64> & line_offsets,
+	  uns32 max_line, uns32 end_of_file_t )
+{
+    if ( ! ::start_scanner_at
+               ( scanner, line_offsets, 0, 0 ) )
+        return 0;
+
+    min::locatable_var<LEX::erroneous_atom> saved;
+    saved = scanner->erroneous_atom;
+    LEX::erroneous_atom_ref(scanner) =
+        ::counting_erroneous_atom;
+
+    uns32 table_ID = 0;
+    while ( true )
+    {
+	uns32 first, next;
+	uns32 type = ::scan_lexeme
+	    ( first, next, scanner, true );
+	if (    type == SCAN_ERROR
+	     || type == end_of_file_t )
+	    break;
+	min::position end =
+	    LEX::input_position ( scanner, next );
+	if ( end.line > max_line ) break;
+	if ( end.line > 0 && end.offset == 0 )
+	{
+	    table_ID = scanner->current_table_ID;
+	    break;
+	}
+    }
+
+    LEX::erroneous_atom_ref(scanner) = saved;
+    return table_ID;
+}
+
+// Write or read n bytes to or from fd, retrying if
+// interrupted.  Return false on error or end of file.
+//
+static bool write_all
+	( int fd, const void * p, size_t n )
+{
+    const char * q = (const char *) p;
+    while ( n > 0 )
+    {
+        ssize_t r = ::write ( fd, q, n );
+	if ( r < 0 && errno == EINTR ) continue;
+	if ( r <= 0 ) return false;
+	q += r;
+	n -= r;
+    }
+    return true;
+}
+
+static bool read_all ( int fd, void * p, size_t n )
+{
+    char * q = (char *) p;
+    while ( n > 0 )
+    {
+        ssize_t r = ::read ( fd, q, n );
+	if ( r < 0 && errno == EINTR ) continue;
+	if ( r <= 0 ) return false;
+	q += r;
+	n -= r;
+    }
+    return true;
+}
+
+// Record written by a worker to its pipe, followed by
+// its lexemes and then its translations.
+//
+struct parallel_header
+{
+    uns32 stop_chunk;
+	// Value of scan_chunks, or BAD_CHUNK if the
+	// worker failed or found erroneous atoms.
+    uns32 lexeme_count;
+    uns32 translation_length;
+
+    uns32 table_ID;
+    min::position next_position;
+    uns32 next_indent;
+        // Scanner state at the end of the scan.
+};
+
+// Scan from the beginning of chunk k > 0 in a worker
+// and write the result to the pipe `out'.  Never
+// returns.
+//
+static void run_worker
+	( min::ref<LEX::scanner> scanner,
+	  const std::vector<uns64> & line_offsets,
+	  const std::vector<uns32> & chunk_lines,
+	  uns32 k, uns32 seam_table_ID,
+	  uns32 end_of_file_t, int out )
+{
+    // The calling process may have handlers for these
+    // that do not suit a worker.
+    //
+    ::signal ( SIGTERM, SIG_DFL );
+    ::signal ( SIGPIPE, SIG_DFL );
+
+    min::locatable_var<LEX::parallel_lexemes> lexemes;
+    lexemes = ::parallel_lexeme_vec_type.new_gen();
+    min::locatable_var<LEX::translation_buffer>
+        translations;
+    translations = ::Uchar_vec_type.new_gen();
+
+    ::parallel_header h;
+    h.stop_chunk = ::BAD_CHUNK;
+    if ( ::start_scanner_at
+             ( scanner, line_offsets, chunk_lines[k],
+	       seam_table_ID ) )
+    {
+	LEX::erroneous_atom_ref(scanner) =
+	    ::counting_erroneous_atom;
+	scanner->erroneous_atom->count = 0;
+	h.stop_chunk = ::scan_chunks
+	    ( scanner, chunk_lines, k, true,
+	      seam_table_ID, end_of_file_t,
+	      lexemes, translations );
+	if ( scanner->erroneous_atom->count > 0 )
+	    h.stop_chunk = ::BAD_CHUNK;
+    }
+    h.lexeme_count = lexemes->length;
+    h.translation_length = translations->length;
+    h.table_ID = scanner->current_table_ID;
+    h.next_position = scanner->next_position;
+    h.next_indent = scanner->next_indent;
+
+    // _exit does not run the atexit functions or flush
+    // the stdio buffers of the calling process.
+    //
+    bool ok =
+        ::write_all ( out, & h, sizeof ( h ) )
+	&&
+	( h.lexeme_count == 0
+	  ||
+	  ::write_all
+	      ( out, ~ & lexemes[0],
+	        sizeof ( LEX::parallel_lexeme )
+		* h.lexeme_count ) )
+	&&
+	( h.translation_length == 0
+	  ||
+	  ::write_all
+	      ( out, ~ & translations[0],
+	        sizeof ( Uchar )
+		* h.translation_length ) );
+    ::_exit ( ok ? 0 : 1 );
+}
+
+// Close the pipe of a worker and wait for it to exit,
+// terminating it first if its result is not wanted.
+// Then set pid and fd to -1.  Return true if the
+// worker exited normally.
+//
+static bool end_worker
+	( pid_t & pid, int & fd, bool terminate )
+{
+    bool ok = false;
+    if ( fd >= 0 ) ::close ( fd );
+    if ( pid > 0 )
+    {
+	if ( terminate ) ::kill ( pid, SIGTERM );
+	int status;
+	pid_t r;
+	do r = ::waitpid ( pid, & status, 0 );
+	while ( r < 0 && errno == EINTR );
+	ok = ( r == pid
+	       &&
+	       WIFEXITED ( status )
+	       &&
+	       WEXITSTATUS ( status ) == 0 );
+    }
+    pid = -1;
+    fd = -1;
+    return ok;
+}
+
+// Read the result of the worker with the given pid and
+// pipe, and append its lexemes and translations.  The
+// worker is ended as per end_worker.  Return false and
+// append nothing if the worker failed.
+//
+static bool read_worker
+	( pid_t & pid, int & fd,
+	  ::parallel_header & h,
+	  LEX::parallel_lexemes lexemes,
+	  LEX::translation_buffer translations )
+{
+    if ( pid < 0 ) return false;
+    if ( ! ::read_all ( fd, & h, sizeof ( h ) )
+	 ||
+	 h.stop_chunk == ::BAD_CHUNK )
+    {
+        ::end_worker ( pid, fd, true );
+        return false;
+    }
+
+    uns32 lfirst = lexemes->length;
+    uns32 tfirst = translations->length;
+    min::push ( lexemes, h.lexeme_count );
+    min::push ( translations, h.translation_length );
+    bool ok =
+	( h.lexeme_count == 0
+	  ||
+	  ::read_all
+	      ( fd, ~ & lexemes[lfirst],
+	        sizeof ( LEX::parallel_lexeme )
+		* h.lexeme_count ) )
+	&&
+	( h.translation_length == 0
+	  ||
+	  ::read_all
+	      ( fd, ~ & translations[tfirst],
+	        sizeof ( Uchar )
+		* h.translation_length ) );
+    ok = ::end_worker ( pid, fd, ! ok ) && ok;
+    if ( ! ok )
+    {
+        min::pop ( lexemes, h.lexeme_count );
+        min::pop ( translations, h.translation_length );
+	return false;
+    }
+
+    for ( uns32 i = lfirst; i < lexemes->length; ++ i )
+        (&lexemes[i])->translation_offset += tfirst;
+    return true;
+}
+
+bool LEX::scan_parallel
+	( min::ref<LEX::parallel_lexemes> lexemes,
+	  min::ref<LEX::translation_buffer> translations,
+	  uns32 end_of_file_t,
+	  uns32 workers,
+	  min::ref<LEX::scanner> scanner )
+{
+    MIN_REQUIRE ( scanner->input == ::mapped_input
+                  ||
+		  scanner->input == ::span_input );
+
+    if ( lexemes == NULL_STUB )
+        lexemes = ::parallel_lexeme_vec_type.new_gen();
+    if ( translations == NULL_STUB )
+        translations = ::Uchar_vec_type.new_gen();
+    if ( ::counting_erroneous_atom == NULL_STUB )
+        LEX::init ( ::counting_erroneous_atom,
+	            ::count_erroneous_atom );
+    LEX::init_checkpoints ( scanner, false );
+
+    // Forking is only safe with no other threads, and
+    // there is no point in more workers than CPUs.
+    //
+    if ( LEX::read_ahead_stream::active > 0 )
+        workers = 1;
+    long cpus = ::sysconf ( _SC_NPROCESSORS_ONLN );
+    if ( cpus > 0 && (long) workers > cpus )
+        workers = (uns32) cpus;
+
+    // Find the lines of the input, and the first line
+    // of each chunk.  Chunk 0 begins at line 0 even if
+    // the input is empty.
+    //
+    uns64 size =
+        scanner->input == ::span_input ?
+	scanner->span_text->length :
+	scanner->mapped_size;
+    std::vector<uns64> line_offsets;
+    ::find_line_offsets ( scanner, line_offsets );
+    uns32 lines = line_offsets.size();
+
+    std::vector<uns32> chunk_lines;
+    chunk_lines.push_back ( 0 );
+    for ( uns32 k = 1; k < workers; ++ k )
+    {
+	uns32 line =
+	    std::lower_bound
+	        ( line_offsets.begin(),
+		  line_offsets.end(),
+		  size * k / workers )
+	    - line_offsets.begin();
+	if ( line < lines && line > chunk_lines.back() )
+	    chunk_lines.push_back ( line );
+    }
+
+    uns32 seam_table_ID = 0;
+    if ( chunk_lines.size() > 1
+         &&
+	 scanner->trace == 0
+	 &&
+	 scanner->profile == NULL_STUB )
+	seam_table_ID = ::find_seam_table
+	    ( scanner, line_offsets, chunk_lines[1],
+	      end_of_file_t );
+    if ( seam_table_ID == 0 )
+	chunk_lines.resize ( 1 );
+    uns32 chunks = chunk_lines.size();
+
+    // Fork a worker for each chunk but chunk 0, which
+    // this process scans while they run.  A chunk
+    // whose pipe or fork fails is left to this
+    // process.
+    //
+    std::vector<pid_t> pids ( chunks, -1 );
+    std::vector<int> fds ( chunks, -1 );
+    for ( uns32 k = 1; k < chunks; ++ k )
+    {
+	int p[2];
+	if ( ::pipe ( p ) < 0 ) break;
+	pids[k] = ::fork();
+	if ( pids[k] == 0 )
+	{
+	    ::close ( p[0] );
+	    for ( uns32 i = 1; i < k; ++ i )
+		::close ( fds[i] );
+	    ::run_worker
+		( scanner, line_offsets, chunk_lines,
+		  k, seam_table_ID, end_of_file_t,
+		  p[1] );
+	}
+	::close ( p[1] );
+	if ( pids[k] < 0 )
+	{
+	    ::close ( p[0] );
+	    break;
+	}
+	fds[k] = p[0];
+    }
+
+    // Stitch together the lexemes of the chunks.  If
+    // chunk k has no worker or its worker failed, scan
+    // chunk k in this process up to the next seam, and
+    // go on with the worker for the chunk found there.
+    //
+    ::parallel_header h;
+    uns32 k = 0;
+    bool ok = true;
+    bool rescanned = false;
+        // True if the scanner is at the end of the last
+	// chunk stitched, because it scanned it.
+    while ( k < chunks )
+    {
+        if ( ::read_worker ( pids[k], fds[k], h,
+	                     lexemes, translations ) )
+	{
+	    k = h.stop_chunk;
+	    rescanned = false;
+	    continue;
+	}
+
+	if ( ! ::start_scanner_at
+	           ( scanner, line_offsets,
+		     chunk_lines[k],
+		     k == 0 ? 0 : seam_table_ID ) )
+	{
+	    ::push_scan_error
+	        ( scanner->next_position,
+		  lexemes, translations );
+	    ok = false;
+	    break;
+	}
+	k = ::scan_chunks
+		( scanner, chunk_lines, k, true,
+		  seam_table_ID, end_of_file_t,
+		  lexemes, translations );
+	if ( k == ::BAD_CHUNK )
+	{
+	    ok = false;
+	    break;
+	}
+	rescanned = true;
+    }
+
+    // Workers of chunks that were skipped are not
+    // wanted.
+    //
+    for ( uns32 i = 1; i < chunks; ++ i )
+	::end_worker ( pids[i], fds[i], true );
+
+    if ( ! ok || rescanned ) return ok;
+
+    // Leave the scanner where the last worker left
+    // its scanner.
+    //
+    ::start_scanner_at
+        ( scanner, line_offsets, lines, h.table_ID );
+    scanner->next_position = h.next_position;
+    scanner->next_indent = h.next_indent;
+    return true;
+}
+
+// Incremental Scanning
+// ----------- --------
+
+bool LEX::rescan_lines
+	( min::ref<LEX::parallel_lexemes> lexemes,
+	  min::ref<LEX::translation_buffer> translations,
+	  uns32 first_line,
+	  uns32 old_next_line,
+	  uns32 new_next_line,
+	  uns32 end_of_file_t,
+	  uns32 & first,
+	  uns32 & old_next,
+	  uns32 & new_next,
+	  min::ref<LEX::scanner> scanner )
+{
+    MIN_REQUIRE ( scanner->checkpoints != NULL_STUB );
+    MIN_REQUIRE ( first_line <= old_next_line );
+    MIN_REQUIRE ( first_line <= new_next_line );
+
+    if ( lexemes == NULL_STUB )
+        lexemes = ::parallel_lexeme_vec_type.new_gen();
+    if ( translations == NULL_STUB )
+        translations = ::Uchar_vec_type.new_gen();
+
+    // Find the last checkpoint at or before first_
+    // line, which is re-recorded by the rescan, and
+    // move it and the later checkpoints to old_
+    // checkpoints.  Resume at line 0 if none.
+    //
+    LEX::checkpoints checkpoints = scanner->checkpoints;
+    uns32 c = 0, high = checkpoints->length;
+    while ( c < high )
+    {
+        uns32 mid = ( c + high ) / 2;
+	if ( (&checkpoints[mid])->line <= first_line )
+	    c = mid + 1;
+	else
+	    high = mid;
+    }
+    uns32 resume_line = 0, table_ID = 0;
+    if ( c > 0 )
+    {
+        -- c;
+	resume_line = (&checkpoints[c])->line;
+	table_ID = (&checkpoints[c])->table_ID;
+    }
+    std::vector<LEX::checkpoint> old_checkpoints;
+    for ( uns32 i = c + 1; i < checkpoints->length;
+                           ++ i )
+        old_checkpoints.push_back ( checkpoints[i] );
+    min::pop ( checkpoints, checkpoints->length - c );
+
+    // Move the old lexemes beginning at or after
+    // resume_line, and their translations, to old_
+    // lexemes and old_translations.  The translation
+    // offsets of old_lexemes are left unchanged, so
+    // old_translations[i] was translations[i+tbase].
+    //
+    first = 0;
+    high = lexemes->length;
+    while ( first < high )
+    {
+        uns32 mid = ( first + high ) / 2;
+	if ( (&lexemes[mid])->begin.line < resume_line )
+	    first = mid + 1;
+	else
+	    high = mid;
+    }
+    uns32 tbase =
+        first < lexemes->length ?
+	(&lexemes[first])->translation_offset :
+	translations->length;
+    std::vector<LEX::parallel_lexeme> old_lexemes;
+    for ( uns32 i = first; i < lexemes->length; ++ i )
+        old_lexemes.push_back ( lexemes[i] );
+    std::vector<Uchar> old_translations;
+    for ( uns32 i = tbase; i < translations->length;
+                           ++ i )
+        old_translations.push_back ( translations[i] );
+    min::pop ( lexemes, lexemes->length - first );
+    min::pop ( translations,
+               translations->length - tbase );
+
+    // Rescan until the scanner is between lexemes at
+    // the beginning of a line at or after new_next_
+    // line in the state of the old checkpoint of that
+    // line, whose line number is old_line.
+    //
+    std::vector<uns64> line_offsets;
+    ::find_line_offsets ( scanner, line_offsets );
+    bool ok = ::start_scanner_at
+        ( scanner, line_offsets, resume_line,
+	  table_ID );
+    if ( ! ok )
+	::push_scan_error
+	    ( scanner->next_position,
+	      lexemes, translations );
+    uns32 k = 0;
+    uns32 old_line = 0;
+    bool converged = false;
+    while ( ok )
+    {
+	uns32 type = ::scan_record
+	    ( scanner, lexemes, translations );
+	if ( type == SCAN_ERROR ) ok = false;
+	if ( type == SCAN_ERROR
+	     ||
+	     type == end_of_file_t )
+	    break;
+
+	min::position end =
+	    (&lexemes[lexemes->length-1])->end;
+	if ( end.offset != 0
+	     ||
+	     end.line < new_next_line )
+	    continue;
+	old_line = end.line - new_next_line
+	                    + old_next_line;
+	while ( k < old_checkpoints.size()
+	        &&
+		old_checkpoints[k].line < old_line )
+	    ++ k;
+	if ( k < old_checkpoints.size()
+	     &&
+	     old_checkpoints[k].line == old_line
+	     &&
+	        old_checkpoints[k].table_ID
+	     == scanner->current_table_ID )
+	{
+	    converged = true;
+	    break;
+	}
+    }
+    new_next = lexemes->length;
+    old_next = first + old_lexemes.size();
+    if ( ! converged ) return ok;
+
+    // Put back the old lexemes beginning at or after
+    // old_line, and the old checkpoints of those
+    // lines, moved by the change in line count.
+    //
+    uns32 delta = new_next_line - old_next_line;
+	// Modulo 2**32.
+    uns32 keep = 0;
+    while ( keep < old_lexemes.size()
+            &&
+	    old_lexemes[keep].begin.line < old_line )
+        ++ keep;
+    old_next = first + keep;
+    if ( keep < old_lexemes.size() )
+    {
+	uns32 toffset =
+	    old_lexemes[keep].translation_offset;
+	uns32 tdelta = translations->length - toffset;
+	uns32 length = tbase + old_translations.size()
+	             - toffset;
+	if ( length > 0 )
+	    min::push
+	        ( translations, length,
+		  min::new_ptr<const Uchar>
+		      ( & old_translations
+		              [toffset - tbase] ) );
+	for ( uns32 i = keep; i < old_lexemes.size();
+	                      ++ i )
+	{
+	    LEX::parallel_lexeme r = old_lexemes[i];
+	    r.begin.line += delta;
+	    r.end.line += delta;
+	    r.translation_offset += tdelta;
+	    min::push(lexemes) = r;
+	}
+    }
+    for ( ; k < old_checkpoints.size(); ++ k )
+    {
+        LEX::checkpoint cp = old_checkpoints[k];
+	cp.line += delta;
+	min::push(checkpoints) = cp;
+    }
+    return true;
+}
+
 // Printing
 // --------
 
@@ -2221,8 +6281,7 @@ min::printer operator <<
 	    << min::break_before_all;
     while ( first < next )
         printer << min::punicode
-	    ( (&scanner->input_buffer[first++])
-	              ->character );
+	    ( LEX::input_character ( scanner, first++ ) );
     return printer << min::restore_print_format;
 }
 
@@ -2230,6 +6289,7 @@ min::printer operator <<
 	( min::printer printer,
 	  const LEX::ptranslation & ptranslation )
 {
+    LEX::expand_translation ( ptranslation.scanner );
     LEX::translation_buffer translation_buffer =
         ptranslation.scanner->translation_buffer;
 
@@ -2274,20 +6334,13 @@ min::printer operator <<
     uns32 first = perroneous_atom.first;
     uns32 next = perroneous_atom.next;
 
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
-
     printer << LEX::pmode ( scanner->program, type )
             << " ";
 
     min::position position =
-        first < input_buffer->length ?
-	    (min::position) input_buffer[first] :
-	    scanner->next_position;
+        LEX::input_position ( scanner, first );
     min::uns32 indent =
-        first < input_buffer->length ?
-	    (&input_buffer[first])->indent :
-	    scanner->next_indent;
+        LEX::input_indent ( scanner, first );
 
     printer << position.line << "("
 	    << position.offset << ")";
@@ -2303,18 +6356,21 @@ bool LEX::translation_is_exact
 	( LEX::scanner scanner,
 	  uns32 first, uns32 next )
 {
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
     LEX::translation_buffer translation_buffer =
         scanner->translation_buffer;
 
+    if ( scanner->translation_is_identity )
+        return first == scanner->lexeme_first
+	       &&
+	       next == scanner->next;
+
     uns32 i = 0;
     if (    translation_buffer->length
          != next - first )
         return false;
     while ( first < next )
     {
-        if (    (&input_buffer[first])->character
+        if (    LEX::input_character ( scanner, first )
 	     != translation_buffer[i] )
 	    return false;
 	++ first, ++ i;
@@ -2322,6 +6378,20 @@ bool LEX::translation_is_exact
     return true;
 }
 
+void LEX::expand_translation ( LEX::scanner scanner )
+{
+    if ( ! scanner->translation_is_identity ) return;
+
+    LEX::translation_buffer translation_buffer =
+        scanner->translation_buffer;
+    MIN_REQUIRE ( translation_buffer->length == 0 );
+    for ( uns32 i = scanner->lexeme_first;
+          i < scanner->next; ++ i )
+	min::push(translation_buffer) =
+	    LEX::input_character ( scanner, i );
+    scanner->translation_is_identity = false;
+}
+
 min::printer operator <<
 	( min::printer printer,
 	  const LEX::pmode & pmode )
@@ -2364,18 +6434,11 @@ min::pline_numbers LEX::pline_numbers
 	( LEX::scanner scanner,
 	  min::uns32 first, min::uns32 next )
 {
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
-
     min::phrase_position position;
     position.begin =
-        first < input_buffer->length ?
-	input_buffer[first] :
-	scanner->next_position;
+        LEX::input_position ( scanner, first );
     position.end =
-        next < input_buffer->length ?
-	input_buffer[next] :
-	scanner->next_position;
+        LEX::input_position ( scanner, next );
 
     return min::pline_numbers
 		( scanner->input_file, position );
@@ -2386,25 +6449,42 @@ min::phrase_position LEX::phrase_position
 	  min::uns32 first,
 	  min::uns32 next )
 {
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
-
     min::phrase_position position;
 
     position.begin =
-        first < input_buffer->length ?
-	    (min::position) input_buffer[first] :
-	    scanner->next_position;
+        LEX::input_position ( scanner, first );
 
     position.end =
-        next < input_buffer->length ?
-	    (min::position) input_buffer[next] :
-	    scanner->next_position;
+        LEX::input_position ( scanner, next );
 
     return position;
 }
 
 
+// If the input was set by init_input_span and its lines
+// are not yet in scanner->input_file, append them, so
+// they can be printed.  They are removed by the next
+// init_input_span.
+//
+static void load_span_lines ( LEX::scanner scanner )
+{
+    min::file file = scanner->input_file;
+    if ( scanner->input != ::span_input
+         ||
+	 file->buffer->length > 0 )
+        return;
+
+    LEX::span_text text = scanner->span_text;
+    if ( text->length == 0 ) return;
+    min::packed_vec_insptr<char> buffer = file->buffer;
+    min::push ( buffer, text->length,
+                min::ptr<const char> ( & text[0] ) );
+    while ( min::next_line ( file ) != min::NO_LINE )
+        ;
+    if ( min::remaining_length ( file ) > 0 )
+        min::skip_remaining ( file );
+}
+
 void LEX::print_phrase_lines
 	( min::printer printer,
 	  LEX::scanner scanner,
@@ -2414,10 +6494,11 @@ void LEX::print_phrase_lines
     min::phrase_position position =
         LEX::phrase_position ( scanner, first, next );
 
+    ::load_span_lines ( scanner );
     min::print_phrase_lines
         ( printer, scanner->input_file, position );
 }
-
+
 // Printing Programs
 // -------- --------
 
@@ -2494,6 +6575,10 @@ static uns32 print_instruction
 	    LEX::translate_to_length ( op );
 	instruction_length += translate_to_length;
     }
+    uns32 skip_to_ID = ID + instruction_length;
+    if ( op & SKIP_TO )
+	instruction_length =
+	    LEX::component_length ( ID, program );
 
     if ( ( ( op & MATCH ) != 0 )
 	 +
@@ -2539,6 +6624,15 @@ static uns32 print_instruction
          ( ( op & RETURN ) != 0 )
 	 > 1 ) printer << "ILLEGAL: ";
     else
+    if ( ( op & SKIP_TO )
+         &&
+	 ( op & (   MATCH
+	          | TRANSLATE_HEX_FLAG
+	          | TRANSLATE_NAME_FLAG
+	          | TRANSLATE_OCT_FLAG
+	          | REQUIRE ) ) )
+	printer << "ILLEGAL: ";
+    else
     if ( ( op & MATCH )
          &&
          ihp->atom_table_ID == 0 )
@@ -2617,6 +6711,22 @@ static uns32 print_instruction
 	     << LEX::keep_length ( op )
 	     << ")";
 
+    if ( op & SKIP_TO )
+    {
+        if ( skip_to_ID >= program->length )
+	    OUT << "ILLEGAL SKIP_TO";
+	else
+	{
+	    uns32 n = program[skip_to_ID];
+	    OUT << "SKIP_TO(" << n << ",";
+	    for ( uns32 p = skip_to_ID + 1;
+		  0 < n && p < program->length;
+		  ++ p, -- n )
+	        printer << pgraphic ( program[p] );
+	    printer << ")";
+	}
+    }
+
     if ( op & TRANSLATE_TO_FLAG )
     {
         translate_to_length =
@@ -2806,17 +6916,16 @@ static uns32 print_cooked_dispatcher
 	    ( program, ID + length );
     length += map_element_length
 	    * ( dhp->max_ctype + 1 );
-    min::ptr<const uns8> ctype_map =
-        dhp->ctype_map_size > 0 ?
-        LEX::ptr<const uns8>
-	    ( program, ID + length ) :
-	min::ptr<const uns8>();
+    uns32 map_ID = ID + length;
     length = dhp->component_length;
 
     printer << min::indent << "Max CType: "
 	<< dhp->max_ctype << min::eol;
     printer << min::indent << "Ctype Map Size: "
-	<< dhp->ctype_map_size << min::eol;
+	<< ctype_map_limit ( dhp->ctype_map_size );
+    if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+        printer << " (two level)";
+    printer << min::eol;
 
     // Construct tmap so that t2 = tmap[t1] iff t2 is
     // the smallest ctype such that mep[t2] == mep[t1].
@@ -2844,7 +6953,6 @@ static uns32 print_cooked_dispatcher
     // the instruction if the instruction_ID is non-
     // zero, and the dispatcher_ID if it is non-zero.
     //
-    uns32 ctype_map_size = dhp->ctype_map_size;
     for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
     {
         if ( t != tmap[t] ) continue;
@@ -2859,9 +6967,9 @@ static uns32 print_cooked_dispatcher
 	for ( Uchar c = 0;
 	      c < min::unicode::index_size; ++ c )
 	{
-	    uns32 cindex = min::Uindex ( c );
-	    uns32 ctype = cindex < ctype_map_size ?
-	                  ctype_map[cindex] : 0;
+	    uns32 ctype = map_ctype
+	        ( program, map_ID, dhp->ctype_map_size,
+		  min::Uindex ( c ) );
 	    if ( tmap[ctype] == t ) pcl.add ( c );
 	}
 
@@ -3012,7 +7120,10 @@ uns32 LEX::print_program_component
 	printer << min::indent << "Max CType: "
 	        << dhp->max_ctype << min::eol;
 	printer << min::indent << "Ctype Map Size: "
-	        << dhp->ctype_map_size << min::eol;
+	        << ctype_map_limit ( dhp->ctype_map_size );
+	if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	    printer << " (two level)";
+	printer << min::eol;
 	length = dispatcher_header_length;
 	printer << min::indent << "CType:"
 	        << min::set_break
@@ -3046,6 +7157,29 @@ uns32 LEX::print_program_component
 	length += map_element_length
 	        * ( dhp->max_ctype + 1 );
 
+	if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	{
+	    uns32 pages =
+	        ctype_map_length ( dhp->ctype_map_size );
+	    printer << min::indent << "CTYPE PAGES:";
+	    for ( uns32 i = 0; i < pages; ++ i )
+	    {
+		if ( i % 4 == 0 )
+		    printer << min::indent
+			    << min::puns
+			           ( i * CTYPE_PAGE_SIZE,
+				     "%8X: " );
+		printer << min::right ( 14 )
+		        << pID ( program[ID + length + i],
+			         program )
+			<< min::right ( 14 );
+	    }
+	    printer << min::bol;
+
+	    length = dhp->component_length;
+	    break;
+	}
+
 	min::ptr<const uns8> ctype_map =
 	    LEX::ptr<const uns8>
 	        ( program, ID + length );
@@ -3065,6 +7199,27 @@ uns32 LEX::print_program_component
 	length = dhp->component_length;
 	break;
     }
+    case CTYPE_PAGE:
+    {
+	printer << pIDindent ( ID, program )
+	        << "CTYPE PAGE" << min::eol;
+	min::ptr<const uns8> page =
+	    LEX::ptr<const uns8>
+	        ( program, ID + ctype_page_header_length );
+	printer << min::indent << "CTYPE VECTOR:";
+	for ( uns32 i = 0; i < CTYPE_PAGE_SIZE; ++ i )
+	{
+	    if ( i % 8 == 0 )
+	        printer << min::indent
+		        << min::puns ( i, "%8X: " );
+	    uns32 ctype = page[i];
+	    printer << min::puns ( ctype, "%5u" );
+	}
+	printer << min::bol;
+
+	length = ctype_page_length;
+	break;
+    }
     case INSTRUCTION:
     {
 	printer << pIDindent ( ID, program );
@@ -3100,15 +7255,9 @@ void LEX::print_program
         if ( cooked ) switch ( program[ID] )
 	{
 	case INSTRUCTION:
+	case CTYPE_PAGE:
 	{
-	    min::ptr<instruction_header> ihp =
-		LEX::ptr<instruction_header>
-		    ( program, ID );
-	    ID += instruction_header_length;
-	    if (   ihp->operation
-		 & LEX::TRANSLATE_TO_FLAG )
-		ID += LEX::translate_to_length
-			    ( ihp->operation );
+	    ID += LEX::component_length ( ID, program );
 	    continue;
 	}
 	}
@@ -3123,6 +7272,712 @@ void LEX::print_program
     printer << min::eom;
 }
 
+// Print the profile counts of the program component
+// with the given ID and length.
+//
+static void print_component_profile
+	( min::printer printer, LEX::program program,
+	  LEX::profile profile, uns32 ID, uns32 length )
+{
+    printer << min::save_print_format
+            << min::no_auto_break
+	    << min::set_indent ( IDwidth );
+
+    switch ( program[ID] )
+    {
+    case TABLE:
+	printer << min::indent << "Profile: "
+	        << profile[ID] << " atoms, "
+	        << profile[ID+1] << " characters";
+	if ( profile[ID+2] != 0 )
+	    printer << ", " << profile[ID+2]
+	            << " clock ticks";
+	printer << min::eol;
+	break;
+    case DISPATCHER:
+    {
+	printer << min::indent << "Profile: "
+	        << profile[ID] << " characters";
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+	{
+	    uns32 p = ID + dispatcher_header_length
+	            + map_element_length * t;
+	    if ( profile[p] != 0 )
+		printer << "," << min::set_break
+		        << " CType " << t << ": "
+			<< profile[p];
+	}
+	printer << min::eol;
+	break;
+    }
+    case INSTRUCTION:
+	printer << min::indent << "Profile: "
+	        << profile[ID] << " executions, "
+	        << profile[ID+1] << " failed";
+	if ( profile[ID+2] != 0 )
+	    printer << "," << min::set_break
+	            << " MATCH memo hits "
+		    << profile[ID+3] << " of "
+		    << profile[ID+2];
+	if ( profile[ID+4] != 0 )
+	    printer << "," << min::set_break
+	            << " REQUIRE memo hits "
+		    << profile[ID+5] << " of "
+		    << profile[ID+4];
+	printer << min::eol;
+	break;
+    }
+
+    printer << min::restore_print_format;
+}
+
+void LEX::print_program_profile
+	( min::printer printer, LEX::program program,
+	  LEX::profile profile, bool cooked,
+	  bool hot_only )
+{
+    MIN_ASSERT ( profile->length == program->length,
+                 "profile does not match program" );
+
+    printer << min::bom;
+
+    uns32 ID = 0;
+    while ( ID < program->length )
+    {
+        uns32 length =
+	    LEX::component_length ( ID, program );
+	if ( ID + length > program->length )
+	{
+	    ID += length;
+	    break;
+	}
+
+	bool hot = false;
+	for ( uns32 i = ID; i < ID + length; ++ i )
+	{
+	    if ( profile[i] != 0 )
+	    {
+	        hot = true;
+		break;
+	    }
+	}
+
+	if ( hot_only && ! hot )
+	    /* do nothing */;
+	else if ( cooked && program[ID] == CTYPE_PAGE )
+	    /* do nothing */;
+	else if ( cooked && program[ID] == INSTRUCTION )
+	{
+	    // Cooked instructions are printed with the
+	    // tables and dispatchers that use them, so
+	    // only list executed ones.
+	    //
+	    if ( hot )
+	    {
+		printer << min::save_print_format
+			<< min::no_auto_break
+			<< min::set_indent ( IDwidth )
+			<< pIDindent ( ID, program )
+			<< "INSTRUCTION" << min::eol
+			<< min::restore_print_format;
+		::print_component_profile
+		    ( printer, program, profile,
+		      ID, length );
+	    }
+	}
+	else
+	{
+	    print_program_component
+		( printer, program, ID, cooked );
+	    ::print_component_profile
+		( printer, program, profile,
+		  ID, length );
+	}
+
+	ID += length;
+    }
+
+    if ( ID > program->length )
+        printer << "  ILLEGALLY TRUNCATED LAST PROGRAM"
+	           " COMPONENT" << min::eol;
+    printer << min::eom;
+}
+
+uns32 LEX::component_length
+	( uns32 ID, LEX::program program )
+{
+    switch ( program[ID] )
+    {
+    case PROGRAM:
+	return LEX::ptr<program_header> ( program, ID )
+	           ->component_length;
+    case TABLE:
+	return table_header_length;
+    case DISPATCHER:
+	return LEX::ptr<dispatcher_header>
+		   ( program, ID )
+	           ->component_length;
+    case CTYPE_PAGE:
+	return ctype_page_length;
+    case INSTRUCTION:
+    {
+	min::ptr<instruction_header> ihp =
+	    LEX::ptr<instruction_header> ( program, ID );
+	uns32 length = instruction_header_length;
+	if ( ihp->operation & LEX::TRANSLATE_TO_FLAG )
+	    length += LEX::translate_to_length
+			  ( ihp->operation );
+	if ( ihp->operation & LEX::SKIP_TO )
+	{
+	    if ( ID + length >= program->length )
+		return program->length + 1 - ID;
+	    length += 1 + program[ID + length];
+	}
+	return length;
+    }
+    default:
+	return program->length + 1 - ID;
+    }
+}
+
+// Compiled Programs
+// -------- --------
+
+uns32 LEX::program_hash ( LEX::program program )
+{
+    // FNV-1a hash of the uns32 elements.
+    //
+    uns32 hash = 2166136261U;
+    for ( uns32 i = 0; i < program->length; ++ i )
+    {
+        hash ^= program[i];
+	hash *= 16777619U;
+    }
+    return hash;
+}
+
+bool LEX::init_compiled_program
+	( LEX::scanner scanner,
+	  const LEX::compiled_program * compiled )
+{
+    LEX::program program = scanner->program;
+    if ( compiled == NULL
+         ||
+	 program == NULL_STUB
+	 ||
+	 compiled->length != program->length
+	 ||
+	 compiled->hash != LEX::program_hash ( program ) )
+    {
+        scanner->compiled = NULL;
+	return false;
+    }
+    scanner->compiled = compiled;
+    return true;
+}
+
+bool LEX::read_compiled_program
+	( const LEX::compiled_program * compiled,
+	  min::ref<LEX::program> program_arg )
+{
+    if ( compiled == NULL ) return false;
+
+    if ( program_arg == NULL_STUB )
+	program_arg = uns32_vec_type.new_gen();
+    LEX::program program = program_arg;
+    min::pop ( program, program->length );
+    min::push
+	( program, compiled->length,
+	  min::new_ptr<const uns32>
+	      ( compiled->program ) );
+    return LEX::convert_program_endianhood
+               ( program );
+}
+
+// Check that the dispatcher at program[ID] can be
+// compiled.  Return true if yes, and false if no after
+// writing an error message to min::error_message.
+//
+static bool check_compiled_dispatcher
+	( LEX::program program, uns32 ID )
+{
+    min::ptr<dispatcher_header> dhp =
+	LEX::ptr<dispatcher_header> ( program, ID );
+    min::ptr<map_element> mep =
+	LEX::ptr<map_element>
+	    ( program, ID + dispatcher_header_length );
+
+    for ( uns32 t = 0; t <= dhp->max_ctype; ++ t )
+    {
+	uns32 dID = (&mep[t])->dispatcher_ID;
+	uns32 iID = (&mep[t])->instruction_ID;
+	if ( ( dID != 0
+	       &&
+	       (    dID >= program->length
+	         || program[dID] != DISPATCHER ) )
+	     ||
+	     ( iID != 0
+	       &&
+	       (    iID >= program->length
+	         || program[iID] != INSTRUCTION ) ) )
+	{
+	    min::init ( min::error_message )
+		<< "LEXICAL PROGRAM COMPILE ERROR:"
+		   " ctype " << t << " of dispatcher "
+		<< pID ( ID, program )
+		<< " maps to an illegal component"
+		<< min::eol;
+	    return false;
+	}
+    }
+
+    uns32 max = ::max_map_ctype ( program, ID );
+    if ( max == 0xFFFFFFFF )
+    {
+	min::init ( min::error_message )
+	    << "LEXICAL PROGRAM COMPILE ERROR:"
+	       " ctype map of dispatcher "
+	    << pID ( ID, program )
+	    << " has an illegal page ID"
+	    << min::eol;
+	return false;
+    }
+    else if ( max > dhp->max_ctype )
+    {
+	min::init ( min::error_message )
+	    << "LEXICAL PROGRAM COMPILE ERROR:"
+	       " ctype map of dispatcher "
+	    << pID ( ID, program )
+	    << " has too large ctype " << max
+	    << min::eol;
+	return false;
+    }
+    return true;
+}
+
+// Print the C++ code that dispatches one character,
+// and any repeats of that character's ctype, for the
+// dispatcher at program[ID].  The code begins with the
+// label `D<ID>:'.
+//
+static void print_compiled_dispatcher
+	( std::ostream & out,
+	  LEX::program program, uns32 ID )
+{
+    min::ptr<dispatcher_header> dhp =
+	LEX::ptr<dispatcher_header> ( program, ID );
+    min::ptr<map_element> mep =
+	LEX::ptr<map_element>
+	    ( program, ID + dispatcher_header_length );
+
+    char ctype[100];
+    if ( dhp->ctype_map_size == 0 )
+        snprintf ( ctype, sizeof ( ctype ), "0" );
+    else if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+        snprintf ( ctype, sizeof ( ctype ),
+	           "( cindex < %u ?"
+		   " ctype_pages_%u[cindex >> 8]"
+		   "[cindex & 0xFF] : 0 )",
+		   ctype_map_limit
+		       ( dhp->ctype_map_size ),
+		   ID );
+    else
+        snprintf ( ctype, sizeof ( ctype ),
+	           "( cindex < %u ?"
+		   " ctype_map_%u[cindex] : 0 )",
+		   dhp->ctype_map_size, ID );
+
+    out << "D" << ID << ":" << endl
+        << "    if ( ! MORE ) return;" << endl
+        << "    cindex = CINDEX;" << endl
+        << "    ++ length;" << endl
+	<< "    switch ( " << ctype << " )" << endl
+	<< "    {" << endl;
+
+    uns32 max_ctype = dhp->max_ctype;
+    std::vector<bool> done ( max_ctype + 1, false );
+
+    for ( uns32 t = 0; t <= max_ctype; ++ t )
+    {
+	if ( done[t] ) continue;
+
+	uns32 dID = (&mep[t])->dispatcher_ID;
+	uns32 iID = (&mep[t])->instruction_ID;
+	uns32 repeat_count = (&mep[t])->repeat_count;
+	if ( dID == 0 && iID == 0 && repeat_count == 0 )
+	    continue;
+
+	// Ctypes with the same map element share code,
+	// unless they repeat, as the repeat loop tests
+	// the ctype.
+	//
+	for ( uns32 t2 = t; t2 <= max_ctype; ++ t2 )
+	{
+	    if ( done[t2] ) continue;
+	    if ( t2 != t
+	         &&
+		 (    repeat_count != 0
+		   || (&mep[t2])->repeat_count != 0
+		   || (&mep[t2])->dispatcher_ID != dID
+		   || (&mep[t2])->instruction_ID != iID ) )
+	        continue;
+	    out << "    case " << t2 << ":" << endl;
+	    done[t2] = true;
+	}
+
+	if ( repeat_count != 0 )
+	    out << "\tcount = " << repeat_count << "U;"
+	        << endl
+		<< "\twhile ( count -- && MORE )" << endl
+		<< "\t{" << endl
+		<< "\t    cindex = CINDEX;" << endl
+		<< "\t    if ( " << ctype << " != " << t
+		<< " ) break;" << endl
+		<< "\t    ++ length;" << endl
+		<< "\t}" << endl;
+	if ( iID != 0 )
+	    out << "\tinstruction_ID = " << iID << ";"
+	        << endl
+	        << "\tatom_length = length;" << endl;
+	if ( dID != 0 )
+	    out << "\tgoto D" << dID << ";" << endl;
+	else
+	    out << "\treturn;" << endl;
+    }
+
+    out << "    default:" << endl
+        << "\treturn;" << endl
+        << "    }" << endl << endl;
+}
+
+// Instruction operations that print_compiled_
+// instruction compiles.  Instructions with any other
+// operation are left to the scanner interpreter.
+//
+const uns32 COMPILED_OPERATIONS =
+    LEX::KEEP_FLAG + LEX::TRANSLATE_TO_FLAG
+  + LEX::OUTPUT + LEX::GOTO + LEX::CALL
+  + LEX::RETURN + LEX::FAIL + LEX::ELSE;
+
+// Print the C++ code that executes the instruction at
+// program[ID] as the scanner interpreter does, if the
+// instruction can be compiled.  The code begins with
+// `case <ID>:' and returns false only if the inter-
+// preter must execute the instruction after all.  An
+// instruction that cannot fail never uses its ELSE.
+//
+static void print_compiled_instruction
+	( std::ostream & out,
+	  LEX::program program, uns32 ID )
+{
+    min::ptr<instruction_header> ihp =
+	LEX::ptr<instruction_header> ( program, ID );
+    uns32 op = ihp->operation;
+    if ( op & ~ ( COMPILED_OPERATIONS | 0xFFFF0000 ) )
+        return;
+
+    out << "    case " << ID << ":" << endl;
+    if ( op & KEEP_FLAG )
+	out << "	if ( atom_length < "
+	    << LEX::keep_length ( op )
+	    << " ) return false;" << endl
+	    << "	atom_length = "
+	    << LEX::keep_length ( op ) << ";" << endl;
+    if ( op & TRANSLATE_TO_FLAG )
+    {
+	out << "	if ( scanner->"
+	       "translation_is_identity )" << endl
+	    << "	    ll::lexeme::expand_translation"
+	       " ( scanner );" << endl;
+	if ( LEX::translate_to_length ( op ) > 0 )
+	    out << "	min::push" << endl
+	        << "	    ( translation_buffer, "
+		<< LEX::translate_to_length ( op )
+		<< "," << endl
+	        << "	      min::new_ptr<const Uchar>"
+		   " ( translate_to_" << ID << " ) );"
+		<< endl;
+    }
+    else
+	out << "	if ( ! scanner->"
+	       "translation_is_identity )" << endl
+	    << "	    for ( uns32 i = 0;"
+	       " i < atom_length; ++ i )" << endl
+	    << "		min::push(translation_buffer) ="
+	    << endl
+	    << "		    (&input_buffer[next + i])"
+	       "->character;" << endl;
+    out << "	return true;" << endl;
+}
+
+bool LEX::print_compiled_program
+	( std::ostream & out,
+	  LEX::program program,
+	  const char * name,
+	  const char * header )
+{
+    // Check the program before printing anything.
+    //
+    uns32 ID = 0;
+    while ( ID < program->length )
+    {
+        uns32 length =
+	    LEX::component_length ( ID, program );
+	if ( ID + length > program->length )
+	{
+	    min::init ( min::error_message )
+		<< "LEXICAL PROGRAM COMPILE ERROR:"
+		   " illegal program component at"
+		   " offset " << ID
+		<< " in the program vector of uns32"
+		   " elements."
+		<< min::eol;
+	    return false;
+	}
+	if ( program[ID] == DISPATCHER
+	     &&
+	     ! ::check_compiled_dispatcher
+	           ( program, ID ) )
+	    return false;
+	ID += length;
+    }
+
+    out << "// This file was automatically generated by"
+        << endl
+	<< "// ll::lexeme::print_compiled_program."
+	<< endl << endl
+	<< "# include <" << header << ">" << endl
+	<< "# include <cstdlib>" << endl
+	<< "using ll::lexeme::uns8;" << endl
+	<< "using ll::lexeme::uns32;" << endl
+	<< "using ll::lexeme::Uchar;" << endl << endl
+	<< "// MORE is true if input_buffer[next+length]"
+	<< endl
+	<< "// exists, calling the scanner input closure"
+	<< endl
+	<< "// if necessary.  CINDEX is the min::Uindex"
+	<< endl
+	<< "// of its character." << endl
+	<< "//" << endl
+	<< "# define MORE \\" << endl
+	<< "    (    next + length < input_buffer->length \\"
+	<< endl
+	<< "      || (*scanner->input->get) \\" << endl
+	<< "             ( scanner, scanner->input ) )"
+	<< endl
+	<< "# define CINDEX \\" << endl
+	<< "    min::Uindex \\" << endl
+	<< "        ( (&input_buffer[next + length]) \\"
+	<< endl
+	<< "\t      ->character )" << endl << endl;
+
+    // If there are two level maps, the ctype pages,
+    // with ctype_page_0 all 0's, are printed before
+    // the maps that use them.
+    //
+    bool two_level = false;
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] == DISPATCHER
+	     &&
+	     (   LEX::ptr<dispatcher_header>
+	             ( program, ID )->ctype_map_size
+	       & TWO_LEVEL_MAP ) )
+	    two_level = true;
+    }
+    if ( two_level )
+	out << "static const uns8 ctype_page_0["
+	    << CTYPE_PAGE_SIZE << "] = { 0 };" << endl
+	    << endl;
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] != CTYPE_PAGE ) continue;
+
+	min::ptr<const uns8> page =
+	    LEX::ptr<const uns8>
+		( program, ID + ctype_page_header_length );
+	out << "static const uns8 ctype_page_" << ID
+	    << "[" << CTYPE_PAGE_SIZE << "] = {";
+	for ( uns32 i = 0; i < CTYPE_PAGE_SIZE; ++ i )
+	{
+	    if ( i % 16 == 0 ) out << endl << "   ";
+	    out << " " << (uns32) page[i];
+	    if ( i + 1 < CTYPE_PAGE_SIZE ) out << ",";
+	}
+	out << " };" << endl << endl;
+    }
+
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] != DISPATCHER ) continue;
+
+	min::ptr<dispatcher_header> dhp =
+	    LEX::ptr<dispatcher_header> ( program, ID );
+	if ( dhp->ctype_map_size == 0 ) continue;
+	if ( dhp->ctype_map_size & TWO_LEVEL_MAP )
+	{
+	    uns32 map_ID = ctype_map_ID_of ( ID, dhp );
+	    uns32 pages =
+	        ctype_map_length ( dhp->ctype_map_size );
+	    out << "static const uns8 * const"
+	           " ctype_pages_" << ID
+		<< "[" << pages << "] = {";
+	    for ( uns32 i = 0; i < pages; ++ i )
+	    {
+		if ( i % 4 == 0 ) out << endl << "   ";
+		out << " ctype_page_"
+		    << (uns32) program[map_ID + i];
+		if ( i + 1 < pages ) out << ",";
+	    }
+	    out << " };" << endl << endl;
+	    continue;
+	}
+	min::ptr<const uns8> ctype_map =
+	    LEX::ptr<const uns8>
+		( program,
+		    ID + dispatcher_header_length
+		  +   ( dhp->max_ctype + 1 )
+		    * map_element_length );
+
+	out << "static const uns8 ctype_map_" << ID
+	    << "[" << dhp->ctype_map_size << "] = {";
+	for ( uns32 cindex = 0;
+	      cindex < dhp->ctype_map_size; ++ cindex )
+	{
+	    if ( cindex % 16 == 0 ) out << endl << "   ";
+	    out << " " << (uns32) ctype_map[cindex];
+	    if ( cindex + 1 < dhp->ctype_map_size )
+	        out << ",";
+	}
+	out << " };" << endl << endl;
+    }
+
+    out << "static void dispatch" << endl
+        << "\t( uns32 dispatcher_ID," << endl
+        << "\t  uns32 & instruction_ID," << endl
+        << "\t  uns32 & atom_length," << endl
+        << "\t  uns32 & length," << endl
+        << "\t  ll::lexeme::scanner scanner )" << endl
+	<< "{" << endl
+	<< "    ll::lexeme::input_buffer input_buffer ="
+	<< endl
+	<< "        scanner->input_buffer;" << endl
+	<< "    uns32 next = scanner->next;" << endl
+	<< "    uns32 cindex, count;" << endl << endl
+	<< "    switch ( dispatcher_ID )" << endl
+	<< "    {" << endl;
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] == DISPATCHER )
+	    out << "    case " << ID << ": goto D" << ID
+	        << ";" << endl;
+    }
+    out << "    default:" << endl
+        << "\tabort();" << endl
+	<< "    }" << endl << endl;
+
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] == DISPATCHER )
+	    ::print_compiled_dispatcher
+	        ( out, program, ID );
+    }
+
+    out << "    (void) count;" << endl
+        << "}" << endl << endl;
+
+    // The translate_to strings of the compiled
+    // instructions are printed before the instruction
+    // code that uses them.
+    //
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] != INSTRUCTION ) continue;
+
+	min::ptr<instruction_header> ihp =
+	    LEX::ptr<instruction_header> ( program, ID );
+	uns32 op = ihp->operation;
+	uns32 n = LEX::translate_to_length ( op );
+	if ( ( op & ~ ( COMPILED_OPERATIONS
+	                | 0xFFFF0000 ) )
+	     ||
+	     ! ( op & TRANSLATE_TO_FLAG )
+	     ||
+	     n == 0 )
+	    continue;
+
+	out << "static const Uchar translate_to_" << ID
+	    << "[" << n << "] = {";
+	for ( uns32 i = 0; i < n; ++ i )
+	{
+	    out << " "
+	        << program[  ID + instruction_header_length
+		           + i]
+		<< "U";
+	    if ( i + 1 < n ) out << ",";
+	}
+	out << " };" << endl;
+    }
+
+    out << endl
+        << "static bool execute" << endl
+        << "	( uns32 instruction_ID," << endl
+        << "	  uns32 & atom_length," << endl
+        << "	  ll::lexeme::scanner scanner )" << endl
+	<< "{" << endl
+	<< "    ll::lexeme::input_buffer input_buffer ="
+	<< endl
+	<< "        scanner->input_buffer;" << endl
+	<< "    ll::lexeme::translation_buffer" << endl
+	<< "        translation_buffer =" << endl
+	<< "            scanner->translation_buffer;"
+	<< endl
+	<< "    uns32 next = scanner->next;" << endl
+	<< "    (void) input_buffer;" << endl
+	<< "    (void) translation_buffer;" << endl
+	<< "    (void) next;" << endl << endl
+	<< "    switch ( instruction_ID )" << endl
+	<< "    {" << endl;
+    for ( ID = 0; ID < program->length;
+          ID += LEX::component_length ( ID, program ) )
+    {
+        if ( program[ID] == INSTRUCTION )
+	    ::print_compiled_instruction
+	        ( out, program, ID );
+    }
+    out << "    default:" << endl
+        << "	return false;" << endl
+	<< "    }" << endl
+        << "}" << endl << endl;
+
+    out << "static const uns32 program["
+        << program->length << "] = {";
+    for ( uns32 i = 0; i < program->length; ++ i )
+    {
+	if ( i % 6 == 0 ) out << endl << "   ";
+	out << " " << (uns32) program[i] << "U";
+	if ( i + 1 < program->length ) out << ",";
+    }
+    out << " };" << endl << endl;
+
+    out << "const ll::lexeme::compiled_program" << endl
+	<< "    " << name << " =" << endl
+	<< "\t{ " << program->length << "U, "
+	<< LEX::program_hash ( program ) << "U,"
+	<< " ::program," << endl
+	<< "	  ::dispatch, ::execute };" << endl;
+
+    return true;
+}
+
 // Name String Scanning
 // ---- ------ --------
 
@@ -3236,6 +8091,7 @@ static min::gen scan_name_string_next_element
     }
 
     ++ count;
+    LEX::expand_translation ( scanner );
     scan_name_string_var var;
     var.previous = previous;
     var.element =
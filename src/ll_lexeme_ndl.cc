@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_ndl.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Fri Jul 14 05:07:20 EDT 2017
+// Date:	Sun Oct 18 22:24:15 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -23,6 +23,9 @@
 # include <cstdlib>
 # include <cstdio>
 # include <cstring>
+# include <string>
+# include <vector>
+# include <map>
 # define LEX ll::lexeme
 # define LEXNDL ll::lexeme::ndl
 # define LEXNDLDATA ll::lexeme::ndl::data
@@ -41,6 +44,9 @@ static min::packed_vec<LEX::uns8>
 static min::packed_vec<LEX::uns32>
        uns32_vec_type
            ( "ll::lexeme::ndl::uns32_vec_type" );
+static min::packed_vec<LEXNDLDATA::ctype_interval>
+       ctype_interval_vec_type
+           ( "ll::lexeme::ndl::ctype_interval_vec_type" );
 static min::packed_vec<LEXNDLDATA::dispatcher>
        dispatcher_vec_type
            ( "ll::lexeme::ndl::dispatcher_vec_type" );
@@ -48,8 +54,12 @@ static min::packed_vec<LEXNDLDATA::instruction>
        instruction_vec_type
            ( "ll::lexeme::ndl::instruction_vec_type" );
 
-min::packed_vec_insptr<LEX::uns8>
-    LEXNDLDATA::uns8_stack;
+min::packed_vec_insptr<LEXNDLDATA::ctype_interval>
+    LEXNDLDATA::interval_stack;
+static min::packed_vec_insptr<LEX::uns8>
+    ctype_map_buffer;
+    // Ctype map expanded from the interval list of a
+    // dispatcher being popped.
 min::packed_vec_insptr<LEX::uns32>
     LEXNDLDATA::uns32_stack;
 min::packed_vec_insptr<LEXNDLDATA::dispatcher>
@@ -59,7 +69,9 @@ min::packed_vec_insptr<LEXNDLDATA::instruction>
 
 static void initialize ( void )
 {
-    LEXNDLDATA::uns8_stack =
+    LEXNDLDATA::interval_stack =
+        ctype_interval_vec_type.new_gen();
+    ::ctype_map_buffer =
         uns8_vec_type.new_gen();
     LEXNDLDATA::uns32_stack =
         uns32_vec_type.new_gen();
@@ -228,8 +240,8 @@ void LEXNDL::begin_program
              "misplaced begin_program(...)" );
     state = INSIDE_PROGRAM;
 
-    min::pop ( uns8_stack, uns8_stack->length );
-    min::resize ( uns8_stack, 10 * CTYPE_MAP_SIZE );
+    min::pop ( interval_stack, interval_stack->length );
+    min::resize ( interval_stack, 1000 );
     min::pop ( uns32_stack, uns32_stack->length );
     min::resize ( uns32_stack, 4000 );
     min::pop ( dispatchers, dispatchers->length );
@@ -250,7 +262,7 @@ void LEXNDL::end_program ( void )
              "misplaced end_program()" );
     state = OUTSIDE_PROGRAM;
 
-    MIN_REQUIRE ( uns8_stack->length == 0 );
+    MIN_REQUIRE ( interval_stack->length == 0 );
     MIN_REQUIRE ( uns32_stack->length == 0 );
     MIN_REQUIRE ( dispatchers->length == 0 );
     MIN_REQUIRE ( instructions->length == 0 );
@@ -292,9 +304,7 @@ static void push_dispatcher ( bool is_others = false )
     (&d)->others_instruction_ID = 0;
     (&d)->others_repeat_count = 0;
     (&d)->is_others_dispatcher = is_others;
-    (&d)->ctype_map_offset = uns8_stack->length;
-
-    min::push ( uns8_stack, CTYPE_MAP_SIZE );
+    (&d)->interval_count = 0;
 
     min::ref<instruction> ci =
         min::push ( instructions );
@@ -307,6 +317,7 @@ static void push_dispatcher ( bool is_others = false )
     (&ci)->output_type = 0;
     (&ci)->goto_table_ID = 0;
     (&ci)->call_table_ID = 0;
+    (&ci)->skip_to_length = 0;
     (&ci)->accept = false;
 
     substate = is_others ? ADD_REPEAT
@@ -340,6 +351,16 @@ static uns32 pop_instruction_group ( uns32 line_number )
 	        & uns32_stack
 		    [length - translate_to_length];
 
+	Uchar skip_to[LEX::SKIP_TO_MAX_LENGTH];
+        min::ptr<Uchar> skip_to_vector = LEX::NULL_TV();
+	if ( (&ci)->skip_to_length > 0 )
+	{
+	    memcpy ( skip_to, (&ci)->skip_to_vector,
+	             sizeof ( skip_to ) );
+	    skip_to_vector =
+	        min::new_ptr<Uchar> ( skip_to );
+	}
+
 	if ( (&ci)->operation != 0 || (&ci)->accept )
 	    instruction_ID = LEX::create_instruction
 		( (&ci)->line_number,
@@ -351,7 +372,9 @@ static uns32 pop_instruction_group ( uns32 line_number )
 		  (&ci)->erroneous_atom_type,
 		  (&ci)->output_type,
 		  (&ci)->goto_table_ID,
-		  (&ci)->call_table_ID );
+		  (&ci)->call_table_ID,
+		  (&ci)->skip_to_length,
+		  skip_to_vector );
 
 	if ( translate_to_length > 0 )
 	    min::pop ( uns32_stack,
@@ -389,13 +412,26 @@ static void pop_dispatcher
     uns32 instruction_ID =
         pop_instruction_group ( (&d)->line_number );
 
+    // Expand the interval list into ctype_map_buffer
+    // in one sweep.
+    //
+    uns32 count = (&d)->interval_count;
+    uns32 base = interval_stack->length - count;
+    uns32 ctype_map_size =
+        count == 0 ? 0 :
+	(&interval_stack[base + count - 1])->next;
+    min::pop ( ctype_map_buffer,
+               ctype_map_buffer->length );
+    min::push ( ctype_map_buffer, ctype_map_size );
+    for ( uns32 i = base; i < base + count; ++ i )
+    {
+        min::ptr<ctype_interval> ip =
+	    & interval_stack[i];
+	memset ( ~ & ctype_map_buffer[ip->first],
+	         ip->ctype, ip->next - ip->first );
+    }
     min::ptr<const uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
-
-    uns32 ctype_map_size = CTYPE_MAP_SIZE;
-    while (    ctype_map_size > 0
-            && ctype_map[ctype_map_size-1] == 0 )
-        -- ctype_map_size;
+        min::begin_ptr_of ( ctype_map_buffer );
 
     if ( discard_dispatcher )
     {
@@ -413,7 +449,7 @@ static void pop_dispatcher
 	min::push(uns32_stack) = (&d)->repeat_count;
 
 	min::pop ( dispatchers );
-	min::pop ( uns8_stack, CTYPE_MAP_SIZE );
+	min::pop ( interval_stack, count );
 
 	substate = DISPATCHERS;
     	return;
@@ -482,7 +518,7 @@ static void pop_dispatcher
     }
 
     min::pop ( dispatchers );
-    min::pop ( uns8_stack, CTYPE_MAP_SIZE );
+    min::pop ( interval_stack, count );
 
     substate = DISPATCHERS;
 }
@@ -525,7 +561,7 @@ void LEXNDL::end_table ( void )
     MIN_REQUIRE ( dispatchers->length == 0 );
     MIN_REQUIRE ( instructions->length == 0 );
     MIN_REQUIRE ( uns32_stack->length == 0 );
-    MIN_REQUIRE ( uns8_stack->length == 0 );
+    MIN_REQUIRE ( interval_stack->length == 0 );
 
     ATTACH ( table_name, dispatcher_ID );
     if ( instruction_ID != 0 )
@@ -535,37 +571,206 @@ void LEXNDL::end_table ( void )
     state = INSIDE_PROGRAM;
 }
 
+// A range is a set of character indices first ..
+// next-1.  Range lists are sorted and disjoint.
+//
+struct range
+{
+    uns32 first, next;
+};
+typedef std::vector< ::range > range_list;
+
+// Append the interval first .. next-1 with the given
+// ctype to the intervals, merging it with the last
+// interval if possible.
+//
+inline void append_interval
+	( std::vector<ctype_interval> & intervals,
+	  uns32 first, uns32 next, uns32 ctype )
+{
+    if ( first >= next ) return;
+    if ( ! intervals.empty()
+         &&
+	 intervals.back().next == first
+	 &&
+	 intervals.back().ctype == ctype )
+	intervals.back().next = next;
+    else
+    {
+	ctype_interval i = { first, next, ctype };
+	intervals.push_back ( i );
+    }
+}
+
+// Add the characters in the ranges to the ctype_map
+// of the parent dispatcher, or if sub is true,
+// subtract them.  Adding gives the parent's max_type_
+// code to the characters that have ctype 0.  Sub-
+// tracting gives ctype 0 to the characters that have
+// ctype max_type_code.  The interval list of the
+// parent is merged with the ranges in one sweep.
+//
+static void add_sub_ranges
+	( const ::range_list & ranges, bool sub = false )
+{
+    if ( ranges.empty() ) return;
+
+    MIN_REQUIRE
+        ( (&current_dispatcher())->interval_count
+	  == 0 );
+    min::ref<dispatcher> d = parent_dispatcher();
+    uns32 t = (&d)->max_type_code;
+    uns32 count = (&d)->interval_count;
+    uns32 base = interval_stack->length - count;
+
+    std::vector<ctype_interval> old ( count );
+    for ( uns32 i = 0; i < count; ++ i )
+        old[i] = interval_stack[base + i];
+    std::vector<ctype_interval> out;
+
+    uns32 j = 0;
+    if ( sub ) for ( uns32 i = 0; i < count; ++ i )
+    {
+	const ctype_interval & iv = old[i];
+	if ( iv.ctype != t )
+	{
+	    ::append_interval
+	        ( out, iv.first, iv.next, iv.ctype );
+	    continue;
+	}
+	while ( j < ranges.size()
+	        &&
+		ranges[j].next <= iv.first ) ++ j;
+	uns32 first = iv.first;
+	for ( uns32 k = j;
+	      k < ranges.size()
+	      &&
+	      ranges[k].first < iv.next; ++ k )
+	{
+	    ::append_interval
+	        ( out, first, ranges[k].first, t );
+	    if ( ranges[k].next > first )
+		first = ranges[k].next;
+	}
+	if ( first < iv.next )
+	    ::append_interval
+	        ( out, first, iv.next, t );
+    }
+    else
+    {
+	uns32 i = 0;
+	for ( j = 0; j < ranges.size(); ++ j )
+	{
+	    uns32 first = ranges[j].first;
+	    uns32 next = ranges[j].next;
+	    while ( i < count && old[i].first < next )
+	    {
+		const ctype_interval & iv = old[i];
+		if ( iv.first > first )
+		    ::append_interval
+		        ( out, first, iv.first, t );
+		if ( iv.next > next )
+		{
+		    first = next;
+		    break;
+		}
+		::append_interval
+		    ( out, iv.first, iv.next, iv.ctype );
+		if ( iv.next > first ) first = iv.next;
+		++ i;
+	    }
+	    ::append_interval ( out, first, next, t );
+	}
+	for ( ; i < count; ++ i )
+	    ::append_interval
+	        ( out, old[i].first, old[i].next,
+		  old[i].ctype );
+    }
+
+    min::pop ( interval_stack, count );
+    if ( ! out.empty() )
+	min::push
+	    ( interval_stack, out.size(),
+	      min::new_ptr<const ctype_interval>
+	          ( & out[0] ) );
+    (&d)->interval_count = out.size();
+}
+
 static void internal_add_sub_chars
 	( const char * ASCII_chars, bool sub = false )
 {
     if ( ASCII_chars == NULL ) return;
 
-    min::ref<dispatcher> d = parent_dispatcher();
+    bool in_set[128];
+    for ( uns32 i = 0; i < 128; ++ i )
+        in_set[i] = false;
     int c;  // use int instead of char to prevent
             // 0 <= c or c < 128 warning message.
-    uns32 t = (&d)->max_type_code;
-    min::ptr<uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
     while ( ( c = * ASCII_chars ++ ) != 0 )
     {
 	ASSERT ( 0 <= c && c < 128,
 	         "non-ASCII character in"
 		 " ASCII_chars" );
+	in_set[c] = true;
+    }
 
-	if ( sub )
+    ::range_list ranges;
+    for ( uns32 first = 0; first < 128; )
+    {
+        if ( ! in_set[first] )
 	{
-	    if ( ctype_map[c] == 0 ) continue;
-	    if ( ctype_map[c] != t ) continue;
-	    ctype_map[c] = 0;
+	    ++ first;
+	    continue;
 	}
+	uns32 next = first + 1;
+	while ( next < 128 && in_set[next] ) ++ next;
+	::range r = { first, next };
+	ranges.push_back ( r );
+	first = next;
+    }
+    ::add_sub_ranges ( ranges, sub );
+}
+
+// Return the list of ranges of the character indices
+// whose Unicode category begins with the given cate-
+// gory, computed once per category from the Unicode
+// category table.
+//
+static const ::range_list & category_ranges
+	( const char * category )
+{
+    static std::map<std::string, ::range_list> cache;
+    std::pair
+        < std::map<std::string, ::range_list>
+	      ::iterator,
+	  bool > p =
+	cache.insert
+	    ( std::make_pair
+	          ( std::string ( category ),
+		    ::range_list() ) );
+    ::range_list & ranges = p.first->second;
+    if ( ! p.second ) return ranges;
+
+    unsigned len = strlen ( category );
+    for ( uns32 cindex = 0; cindex < CTYPE_MAP_SIZE;
+                            ++ cindex )
+    {
+	const char * cat =
+	    min::unicode::category[cindex];
+        if (    cat == NULL
+	     || strncmp ( category, cat, len ) != 0 )
+	    continue;
+	if ( ! ranges.empty()
+	     &&
+	     ranges.back().next == cindex )
+	    ++ ranges.back().next;
 	else
 	{
-	    if ( ctype_map[c] == t ) continue;
-	    if ( ctype_map[c] != 0 ) continue;
-	    ctype_map[c] = t;
+	    ::range r = { cindex, cindex + 1 };
+	    ranges.push_back ( r );
 	}
-
     }
+    return ranges;
 }
 
 static uns32 * atom_pattern_name_p;
@@ -613,7 +818,7 @@ void LEXNDL::end_atom_pattern ( void )
     MIN_REQUIRE ( dispatchers->length == 0 );
     MIN_REQUIRE ( instructions->length == 0 );
     MIN_REQUIRE ( uns32_stack->length == 0 );
-    MIN_REQUIRE ( uns8_stack->length == 0 );
+    MIN_REQUIRE ( interval_stack->length == 0 );
 
     state = INSIDE_PROGRAM;
 }
@@ -656,13 +861,10 @@ void LEXNDL::add_char ( Uchar c )
     ASSERT ( c < 256,
              "add_char() c is not LATIN1 or ASCII" );
 
-    min::ref<dispatcher> d = parent_dispatcher();
-    uns32 t = (&d)->max_type_code;
-    min::ptr<uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
-    if ( ctype_map[c] == t ) return;
-    if ( ctype_map[c] != 0 ) return;
-    ctype_map[c] = t;
+    ::range_list ranges ( 1 );
+    ranges[0].first = c;
+    ranges[0].next = c + 1;
+    ::add_sub_ranges ( ranges );
 }
 
 void LEXNDL::sub_char ( Uchar c )
@@ -677,13 +879,10 @@ void LEXNDL::sub_char ( Uchar c )
     ASSERT ( c < 256,
              "sub_char() c is not LATIN1 or ASCII" );
 
-    min::ref<dispatcher> d = parent_dispatcher();
-    uns32 t = (&d)->max_type_code;
-    min::ptr<uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
-    if ( ctype_map[c] == 0 ) return;
-    if ( ctype_map[c] != t ) return;
-    ctype_map[c] = 0;
+    ::range_list ranges ( 1 );
+    ranges[0].first = c;
+    ranges[0].next = c + 1;
+    ::add_sub_ranges ( ranges, true );
 }
 
 void LEXNDL::add_category ( const char * category )
@@ -696,23 +895,7 @@ void LEXNDL::add_category ( const char * category )
     ASSERT ( substate == ADD_CHARACTERS,
              "add_category() misplaced" );
 
-    min::ref<dispatcher> d = parent_dispatcher();
-    uns32 t = (&d)->max_type_code;
-    min::ptr<uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
-    unsigned len = strlen ( category );
-    for ( uns32 cindex = 0; cindex < CTYPE_MAP_SIZE;
-                            ++ cindex )
-    {
-	const char * cat =
-	    min::unicode::category[cindex];
-        if (    cat == NULL
-	     || strncmp ( category, cat, len ) != 0 )
-	    continue;
-	if ( ctype_map[cindex] == t ) continue;
-	if ( ctype_map[cindex] != 0 ) continue;
-	ctype_map[cindex] = t;
-    }
+    ::add_sub_ranges ( ::category_ranges ( category ) );
 }
 
 void LEXNDL::sub_category ( const char * category )
@@ -725,23 +908,8 @@ void LEXNDL::sub_category ( const char * category )
     ASSERT ( substate == ADD_CHARACTERS,
              "sub_category() misplaced" );
 
-    min::ref<dispatcher> d = parent_dispatcher();
-    uns32 t = (&d)->max_type_code;
-    min::ptr<uns8> ctype_map =
-        & uns8_stack[(&d)->ctype_map_offset];
-    unsigned len = strlen ( category );
-    for ( uns32 cindex = 0; cindex < CTYPE_MAP_SIZE;
-                            ++ cindex )
-    {
-	const char * cat =
-	    min::unicode::category[cindex];
-        if (    cat == NULL
-	     || strncmp ( category, cat, len ) != 0 )
-	    continue;
-	if ( ctype_map[cindex] == 0 ) continue;
-	if ( ctype_map[cindex] != t ) continue;
-	ctype_map[cindex] = 0;
-    }
+    ::add_sub_ranges
+        ( ::category_ranges ( category ), true );
 }
 
 void LEXNDL::REPEAT ( uns32 repeat_count )
@@ -849,6 +1017,51 @@ void LEXNDL::keep ( uns32 n )
     (&ci)->operation |= LEX::KEEP ( n );
 }
 
+void LEXNDL::skip_to ( const char * delimiters )
+{
+    uns32 length = strlen ( delimiters );
+    Uchar buffer[length];
+    for ( uns32 i = 0; i < length; ++ i )
+        buffer[i] = (uns8) delimiters[i];
+    LEXNDL::skip_to ( length, buffer );
+}
+void LEXNDL::skip_to
+	( uns32 n, const Uchar * delimiters )
+{
+    FUNCTION ( "skip_to" );
+    ASSERT ( state == INSIDE_TABLE,
+             "skip_to() misplaced" );
+    substate = ::INSTRUCTION;
+
+    min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! (&ci)->accept,
+             "skip_to() conflicts with accept()" );
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "skip_to() conflicts with another"
+	     " skip_to()" );
+    ASSERT ( ! (   (&ci)->operation
+                 & (   LEX::MATCH
+	             | LEX::TRANSLATE_OCT_FLAG
+	             | LEX::TRANSLATE_NAME_FLAG
+	             | LEX::TRANSLATE_HEX_FLAG
+		     | LEX::REQUIRE ) ),
+             "skip_to() conflicts with match(),"
+	     " translate_oct/hex/name(), or"
+	     " require()" );
+    ASSERT ( 0 < n && n <= LEX::SKIP_TO_MAX_LENGTH,
+             "skip_to() delimiters length (%d) is 0"
+	     " or too large (> %d)",
+	     n, LEX::SKIP_TO_MAX_LENGTH );
+    ASSERT ( delimiters != NULL,
+	     "skip_to delimiters == NULL" );
+
+    INSTRUCTION_LINE;
+    (&ci)->operation |= LEX::SKIP_TO;
+    (&ci)->skip_to_length = n;
+    for ( uns32 i = 0; i < n; ++ i )
+        (&ci)->skip_to_vector[i] = delimiters[i];
+}
+
 void LEXNDL::translate_to
 	( const char * translation_string )
 {
@@ -900,6 +1113,8 @@ void LEXNDL::translate_oct ( uns32 m, uns32 n )
     substate = ::INSTRUCTION;
 
     min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "translate_oct() conflicts with skip_to()" );
     ASSERT ( ! (&ci)->accept,
              "translate_oct() conflicts with"
 	     " accept()" );
@@ -931,6 +1146,8 @@ void LEXNDL::translate_hex ( uns32 m, uns32 n )
     substate = ::INSTRUCTION;
 
     min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "translate_hex() conflicts with skip_to()" );
     ASSERT ( ! (&ci)->accept,
              "translate_hex() conflicts with"
 	     " accept()" );
@@ -961,6 +1178,8 @@ void LEXNDL::translate_name ( uns32 m, uns32 n )
     substate = ::INSTRUCTION;
 
     min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "translate_name() conflicts with skip_to()" );
     ASSERT ( ! (&ci)->accept,
              "translate_name() conflicts with"
 	     " accept()" );
@@ -992,6 +1211,8 @@ void LEXNDL::match ( uns32 table_name )
     substate = ::INSTRUCTION;
 
     min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "match() conflicts with skip_to()" );
 
     ASSERT ( ! (&ci)->accept,
              "match() conflicts with accept()" );
@@ -1019,6 +1240,8 @@ void LEXNDL::require ( uns32 atom_pattern_name )
 	     " atom pattern" );
 
     min::ref<instruction> ci = current_instruction();
+    ASSERT ( ! ( (&ci)->operation & LEX::SKIP_TO ),
+             "require() conflicts with skip_to()" );
     ASSERT ( ! (&ci)->accept,
              "require() conflicts with accept()" );
     ASSERT ( ! ( (&ci)->operation & REQUIRE ),
@@ -1219,5 +1442,6 @@ void LEXNDL::ELSE ( void )
     (&i2)->output_type = 0;
     (&i2)->goto_table_ID = 0;
     (&i2)->call_table_ID = 0;
+    (&i2)->skip_to_length = 0;
     (&i2)->accept = false;
 }
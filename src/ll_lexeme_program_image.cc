@@ -0,0 +1,48 @@
+// Layered Languages Lexical Program Image Writer
+//
+// File:	ll_lexeme_program_image.cc
+// Author:	Bob Walton (walton@acm.org)
+// Date:	Mon Oct 19 13:24:50 EDT 2026
+//
+// The authors have placed this program in the public
+// domain; they make no warranty and accept no liability
+// for this program.
+
+// ll_lexeme_program_image ll_lexeme_standard.llp
+//
+// Writes an image of the standard lexical program,
+// optimized by ll::lexeme::optimize_program, to the
+// named file.  See ll::lexeme::write_program_image
+// and ll::lexeme::standard::init_standard_program.
+
+# include <ll_lexeme.h>
+# include <ll_lexeme_standard.h>
+# include <iostream>
+# define LEX ll::lexeme
+# define LEXSTD ll::lexeme::standard
+
+int main ( int argc, const char * argv[] )
+{
+    if ( argc != 2 )
+    {
+        std::cerr << "usage: ll_lexeme_program_image"
+	             " image-file" << std::endl;
+	return 1;
+    }
+
+    min::initialize();
+    LEXSTD::init_standard_program();
+    if ( ! LEX::optimize_program
+               ( LEXSTD::default_program ) )
+    {
+        std::cerr << min::error_message;
+	return 1;
+    }
+    if ( ! LEX::write_program_image
+	       ( argv[1], LEXSTD::default_program ) )
+    {
+        std::cerr << min::error_message;
+	return 1;
+    }
+    return 0;
+}
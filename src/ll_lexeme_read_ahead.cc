@@ -0,0 +1,254 @@
+// Layered Languages Read Ahead Input
+//
+// File:	ll_lexeme_read_ahead.cc
+// Author:	Bob Walton (walton@acm.org)
+// Date:	Mon Oct 19 12:46:03 PM EDT 2026
+//
+// The authors have placed this program in the public
+// domain; they make no warranty and accept no liability
+// for this program.
+
+// This file holds ll::lexeme::init_input_read_ahead and
+// ll::parser::init_input_read_ahead.  It is not in
+// liblayered.a, as it is the only code that uses
+// threads: `make read_ahead' in lib makes ll_lexeme_
+// read_ahead.o, which a program using read ahead must
+// link along with -pthread.
+
+# include <ll_parser.h>
+# include <iostream>
+# include <cstring>
+# include <cerrno>
+# include <fcntl.h>
+# include <unistd.h>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <atomic>
+# define LEX ll::lexeme
+# define PAR ll::parser
+
+// A read_ahead_buffer is the streambuf of an istream
+// that is filled by a background thread that reads the
+// file into two chunks in turn.  Chunk i belongs to the
+// reader while full[i] is false and to underflow while
+// it is true.  Neither side locks unless it must wait
+// for the other, in which case it sets its `waiting'
+// flag and waits on `changed'; the other side locks
+// and notifies only if that flag is set.
+//
+// The reader thread touches only the chunks and the
+// file descriptor, never MIN objects, as the MIN
+// garbage collector is not thread safe.  Characters
+// are still decoded by the scanner thread.
+//
+struct read_ahead_buffer
+    : public LEX::read_ahead_stream,
+      public std::streambuf
+{
+    enum { CHUNK_SIZE = 1 << 16 };
+
+    int fd;
+    char chunk[2][CHUNK_SIZE];
+    long length[2];
+        // Bytes in chunk; 0 at end of file.
+    int read_error;
+        // Set by the reader thread to the errno of a
+	// failed read before it gives underflow the
+	// final chunk of length 0.
+    std::atomic<bool> full[2];
+    std::atomic<bool> stop;
+    std::atomic<bool> reader_waiting;
+    std::atomic<bool> consumer_waiting;
+    std::mutex mutex;
+    std::condition_variable changed;
+    unsigned current;
+        // Chunk being consumed.
+    bool in_use;
+        // True if chunk[current] is the get area.
+    std::istream stream;
+    std::thread reader;
+
+    read_ahead_buffer ( int fd )
+        : fd ( fd ), read_error ( 0 ), stop ( false ),
+	  reader_waiting ( false ),
+	  consumer_waiting ( false ),
+	  current ( 0 ), in_use ( false ),
+	  stream ( this )
+    {
+        full[0] = full[1] = false;
+	reader = std::thread
+	    ( & read_ahead_buffer::read_file, this );
+    }
+
+    ~ read_ahead_buffer ( void )
+    {
+        stop = true;
+	notify ( reader_waiting, true );
+	reader.join();
+	::close ( fd );
+    }
+
+    // Wake the other side if it is waiting (or if
+    // always is true).
+    //
+    void notify ( std::atomic<bool> & waiting,
+                  bool always = false )
+    {
+        if ( waiting || always )
+	{
+	    std::lock_guard<std::mutex> lock ( mutex );
+	    changed.notify_all();
+	}
+    }
+
+    // Wait until full[i] == value or stop is set.
+    //
+    void wait ( std::atomic<bool> & waiting,
+                unsigned i, bool value )
+    {
+        if ( full[i] == value || stop ) return;
+	std::unique_lock<std::mutex> lock ( mutex );
+	waiting = true;
+	while ( full[i] != value && ! stop )
+	    changed.wait ( lock );
+	waiting = false;
+    }
+
+    // Body of the reader thread.  After end of file or
+    // a read error the next chunk given to underflow
+    // has length 0 and is the last.
+    //
+    void read_file ( void )
+    {
+        bool last = false;
+        for ( unsigned i = 0; ; i ^= 1 )
+	{
+	    wait ( reader_waiting, i, false );
+	    if ( stop ) return;
+
+	    long n = 0;
+	    while ( ! last && n < CHUNK_SIZE )
+	    {
+	        long r = ::read ( fd, chunk[i] + n,
+		                  CHUNK_SIZE - n );
+		if ( r < 0 && errno == EINTR )
+		    continue;
+		if ( r < 0 )
+		    read_error = errno;
+		if ( r <= 0 )
+		    last = true;
+		else
+		    n += r;
+	    }
+	    length[i] = n;
+	    full[i] = true;
+	    notify ( consumer_waiting );
+	    if ( n == 0 ) return;
+	}
+    }
+
+    // A read error sets the badbit of the stream, so
+    // it is not mistaken for end of file, and sets
+    // `error' (which, unlike read_error, belongs to
+    // the scanner thread).
+    //
+    int_type underflow ( void )
+    {
+        if ( in_use )
+	{
+	    full[current] = false;
+	    notify ( reader_waiting );
+	    current ^= 1;
+	    in_use = false;
+	}
+	wait ( consumer_waiting, current, true );
+	if ( length[current] == 0 )
+	{
+	    if ( read_error != 0 && error == 0 )
+	    {
+	        error = read_error;
+		stream.setstate ( std::ios_base::badbit );
+	    }
+	    return traits_type::eof();
+	}
+	in_use = true;
+	setg ( chunk[current], chunk[current],
+	       chunk[current] + length[current] );
+	return traits_type::to_int_type
+	    ( * chunk[current] );
+    }
+};
+
+bool LEX::init_input_read_ahead
+	( min::ref<LEX::scanner> scanner,
+	  min::gen file_name,
+	  const min::line_format * line_format,
+	  uns32 spool_lines )
+{
+    LEX::init ( scanner );
+    LEX::close_input ( scanner );
+
+    min::str_ptr sp ( file_name );
+    int fd = ::open ( ~ min::begin_ptr_of ( sp ),
+                      O_RDONLY );
+    if ( fd < 0 )
+    {
+	min::init ( min::error_message )
+	    << "ERROR: cannot open file "
+	    << file_name << ": "
+	    << ::strerror ( errno )
+	    << min::eol;
+        return false;
+    }
+    ::posix_fadvise ( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    read_ahead_buffer * buffer =
+        new read_ahead_buffer ( fd );
+    scanner->read_ahead = buffer;
+    min::init_input_stream
+	( LEX::input_file_ref(scanner),
+	  buffer->stream, line_format, spool_lines );
+    min::init_file_name
+        ( LEX::input_file_ref(scanner), file_name );
+    return true;
+}
+
+bool PAR::init_input_read_ahead
+	( PAR::parser parser,
+	  min::gen file_name,
+	  const min::line_format * line_format,
+	  min::uns32 spool_lines )
+{
+    MIN_ASSERT ( parser != min::NULL_STUB,
+                 "init parser before calling"
+		 " init_input_..." );
+    MIN_ASSERT ( parser->scanner != min::NULL_STUB,
+                 "init scanner before calling"
+		 " init_input_..." );
+
+    // As for the other parser init_input_...
+    // functions, parser and scanner share one
+    // input_file.
+    //
+    LEX::scanner scanner = parser->scanner;
+    if ( parser->input_file == scanner->input_file )
+        ;
+    else if ( parser->input_file == min::NULL_STUB )
+	PAR::input_file_ref(parser) =
+		scanner->input_file;
+    else if ( scanner->input_file == min::NULL_STUB )
+	LEX::input_file_ref(scanner) =
+		parser->input_file;
+    else MIN_ABORT
+	( "input_file of parser and"
+	  " parser->scanner are not the same" );
+
+    if ( ! LEX::init_input_read_ahead
+	       ( PAR::scanner_ref(parser), file_name,
+	         line_format, spool_lines ) )
+        return false;
+    PAR::input_file_ref(parser) =
+        parser->scanner->input_file;
+    return true;
+}
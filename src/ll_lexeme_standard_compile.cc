@@ -0,0 +1,38 @@
+// Layered Languages Standard Lexical Program Compiler
+//
+// File:	ll_lexeme_standard_compile.cc
+// Author:	Bob Walton (walton@acm.org)
+// Date:	Sun Oct 18 09:41:12 EDT 2026
+//
+// The authors have placed this program in the public
+// domain; they make no warranty and accept no liability
+// for this program.
+
+// ll_lexeme_standard_compile > \
+//	ll_lexeme_standard_compiled.cc
+//
+// Writes the compiled dispatch code of the standard
+// lexical program to the standard output.  See
+// ll::lexeme::print_compiled_program.
+
+# include <ll_lexeme.h>
+# include <ll_lexeme_standard.h>
+# include <iostream>
+# define LEX ll::lexeme
+# define LEXSTD ll::lexeme::standard
+
+int main ( int argc, const char * argv[] )
+{
+    min::initialize();
+    LEXSTD::init_standard_program();
+    if ( ! LEX::print_compiled_program
+	       ( std::cout, LEXSTD::default_program,
+	         "ll::lexeme::standard::"
+		 "compiled_default_program",
+		 "ll_lexeme_standard.h" ) )
+    {
+        std::cerr << min::error_message;
+	return 1;
+    }
+    return 0;
+}
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_test.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Wed May 24 07:19:15 EDT 2023
+// Date:	Mon Oct 19 13:44:08 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -13,6 +13,7 @@
 //	Usage and Setup
 //	Basic Input Test
 //	Input Test
+//	Rescan Test
 
 // Usage and Setup
 // ----- --- -----
@@ -21,6 +22,8 @@
 # include <ll_lexeme_program_data.h>
 # include <ll_lexeme_test.h>
 # include <iostream>
+# include <string>
+# include <vector>
 # define LEX ll::lexeme
 # define LEXDATA ll::lexeme::program_data
 using std::cout;
@@ -183,13 +186,9 @@ static void set_codes
         printer->print_format;
 
     min::position begin_pos =
-        first < scanner->input_buffer->length ?
-        (min::position) scanner->input_buffer[first] :
-	scanner->next_position;
+        LEX::input_position ( scanner, first );
     min::position end_pos =
-        next < scanner->input_buffer->length ?
-        (min::position) scanner->input_buffer[next] :
-	scanner->next_position;
+        LEX::input_position ( scanner, next );
 
     do
     {
@@ -297,3 +296,222 @@ void LEX::test_input ( uns32 end_of_file_t )
 
     flush_codes();
 }
+
+// Rescan Test
+// ------ ----
+
+static min::packed_vec<LEX::Uchar>
+    rescan_translations_type
+	( "ll::lexeme::rescan_translations_type" );
+static min::packed_vec<LEX::parallel_lexeme>
+    rescan_lexemes_type
+	( "ll::lexeme::rescan_lexemes_type" );
+
+static min::locatable_var<LEX::erroneous_atom>
+    rescan_erroneous_atom;
+
+static void count_erroneous_atom
+	( uns32 first, uns32 next, uns32 type,
+	  LEX::scanner scanner,
+	  LEX::erroneous_atom erroneous_atom )
+{
+    ++ erroneous_atom->count;
+}
+
+// Return true if lexeme i of lexemes1 and lexeme j of
+// lexemes2 have the same type, translation, and
+// positions after the line numbers of lexemes1 are
+// moved by delta.
+//
+static bool same_lexeme
+	( LEX::parallel_lexemes lexemes1,
+	  LEX::translation_buffer translations1,
+	  uns32 i,
+	  LEX::parallel_lexemes lexemes2,
+	  LEX::translation_buffer translations2,
+	  uns32 j,
+	  uns32 delta = 0 )
+{
+    min::ptr<LEX::parallel_lexeme> p1 = & lexemes1[i];
+    min::ptr<LEX::parallel_lexeme> p2 = & lexemes2[j];
+    min::position begin = p1->begin;
+    min::position end = p1->end;
+    begin.line += delta;
+    end.line += delta;
+    bool same = ( p1->type == p2->type
+		  &&
+		  begin == p2->begin
+		  &&
+		  end == p2->end
+		  &&
+		     p1->translation_length
+		  == p2->translation_length );
+    for ( uns32 k = 0;
+	  same && k < p1->translation_length; ++ k )
+	same = (    translations1
+			[p1->translation_offset + k]
+		 == translations2
+			[p2->translation_offset + k] );
+    return same;
+}
+
+// Scan the span text with LEX::rescan_lines from line
+// first_line, as per an edit of old lines first_line
+// .. old_next_line-1 into new lines first_line ..
+// new_next_line-1, with the first, old_next, and
+// new_next results.  Erroneous atoms are just
+// counted.
+//
+static void rescan_span
+	( const std::string & text,
+	  min::ref<LEX::parallel_lexemes> lexemes,
+	  min::ref<LEX::translation_buffer> translations,
+	  uns32 first_line,
+	  uns32 old_next_line,
+	  uns32 new_next_line,
+	  uns32 end_of_file_t,
+	  uns32 & first,
+	  uns32 & old_next,
+	  uns32 & new_next )
+{
+    LEX::init_input_span
+	( LEX::default_scanner,
+	  min::new_ptr ( text.c_str() ), text.size(),
+	  min::eol_line_format );
+    LEX::erroneous_atom_ref(LEX::default_scanner) =
+        ::rescan_erroneous_atom;
+    LEX::rescan_lines
+        ( lexemes, translations,
+	  first_line, old_next_line, new_next_line,
+	  end_of_file_t, first, old_next, new_next );
+}
+
+void LEX::test_rescan
+	( const std::string & text, uns32 edit_line,
+	  uns32 end_of_file_t )
+{
+    LEX::scanner scanner = LEX::default_scanner;
+    LEX::init ( ::rescan_erroneous_atom,
+                ::count_erroneous_atom );
+
+    std::vector<std::string> lines;
+    for ( std::size_t p = 0; p < text.size(); )
+    {
+        std::size_t q = text.find ( '\n', p );
+	q = ( q == std::string::npos ?
+	      text.size() : q + 1 );
+	lines.push_back ( text.substr ( p, q - p ) );
+	p = q;
+    }
+    std::string edited;
+    for ( uns32 i = 0; i < lines.size(); ++ i )
+    {
+        if ( i == edit_line )
+	    edited += "edited 12.5 \"text\" x\n"
+	              "added ( line )\n";
+	else
+	    edited += lines[i];
+    }
+
+    // Scan the text, and save the lexemes.
+    //
+    uns32 first, old_next, new_next;
+    min::locatable_var<LEX::parallel_lexemes> lexemes;
+    min::locatable_var<LEX::translation_buffer>
+        translations;
+    LEX::init_checkpoints ( scanner, true );
+    ::rescan_span ( text, lexemes, translations,
+                    0, 0, 0, end_of_file_t,
+		    first, old_next, new_next );
+    min::locatable_var<LEX::parallel_lexemes>
+        old_lexemes
+	    ( ::rescan_lexemes_type.new_stub() );
+    min::locatable_var<LEX::translation_buffer>
+        old_translations
+	    ( ::rescan_translations_type.new_stub() );
+    for ( uns32 i = 0; i < lexemes->length; ++ i )
+        min::push(old_lexemes) = lexemes[i];
+    for ( uns32 i = 0;
+          i < translations->length; ++ i )
+        min::push(old_translations) = translations[i];
+
+    // Rescan the edit.
+    //
+    ::rescan_span ( edited, lexemes, translations,
+                    edit_line, edit_line + 1,
+		    edit_line + 2, end_of_file_t,
+		    first, old_next, new_next );
+    std::vector<LEX::checkpoint> checkpoints;
+    for ( uns32 i = 0;
+          i < scanner->checkpoints->length; ++ i )
+        checkpoints.push_back
+	    ( scanner->checkpoints[i] );
+
+    // Scan the edited text from scratch.
+    //
+    uns32 first2, old_next2, new_next2;
+    min::locatable_var<LEX::parallel_lexemes> lexemes2;
+    min::locatable_var<LEX::translation_buffer>
+        translations2;
+    LEX::init_checkpoints ( scanner, true );
+    ::rescan_span ( edited, lexemes2, translations2,
+                    0, 0, 0, end_of_file_t,
+		    first2, old_next2, new_next2 );
+
+    bool same = ( lexemes->length == lexemes2->length );
+    for ( uns32 i = 0;
+          same && i < lexemes->length; ++ i )
+        same = ::same_lexeme
+	    ( lexemes, translations, i,
+	      lexemes2, translations2, i );
+    scanner->printer
+        << "rescan_lines lexemes "
+	<< ( same ? "are" : "are NOT" )
+	<< " the same as a full scan" << min::eol;
+
+    same = (    checkpoints.size()
+             == scanner->checkpoints->length );
+    for ( uns32 i = 0;
+          same && i < checkpoints.size(); ++ i )
+    {
+	min::ptr<LEX::checkpoint> cp =
+	    & scanner->checkpoints[i];
+        same = ( checkpoints[i].line == cp->line
+	         &&
+		 checkpoints[i].table_ID == cp->table_ID );
+    }
+    scanner->printer
+        << "rescan_lines checkpoints "
+	<< ( same ? "are" : "are NOT" )
+	<< " the same as a full scan" << min::eol;
+
+    // Lexemes before first are unchanged, and lexemes
+    // from new_next on are the old lexemes from old_
+    // next on moved down one line.
+    //
+    same = ( first <= old_next
+             &&
+	     first <= new_next
+	     &&
+	        old_lexemes->length - old_next
+	     == lexemes->length - new_next );
+    for ( uns32 i = 0; same && i < first; ++ i )
+        same = ::same_lexeme
+	    ( old_lexemes, old_translations, i,
+	      lexemes, translations, i );
+    for ( uns32 i = new_next;
+          same && i < lexemes->length; ++ i )
+        same = ::same_lexeme
+	    ( old_lexemes, old_translations,
+	      i - new_next + old_next,
+	      lexemes, translations, i, 1 );
+    scanner->printer
+        << "rescan_lines lexemes outside the rescan "
+	<< ( same ? "are" : "are NOT" )
+	<< " the old lexemes" << min::eol;
+    scanner->printer
+        << "rescan_lines "
+	<< ( new_next < lexemes->length ?
+	     "stopped" : "did NOT stop" )
+	<< " before the end of file" << min::eol;
+}
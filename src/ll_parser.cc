@@ -2,7 +2,7 @@
 //
 // File:	ll_parser.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Wed Jul  2 07:19:55 AM EDT 2025
+// Date:	Mon Oct 19 12:46:03 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -722,6 +722,7 @@ void PAR::init ( min::ref<PAR::parser> parser,
 	parser->error_count = 0;
 	parser->warning_count = 0;
 	parser->max_error_count = 100;
+	parser->streaming = false;
 	parser->subexpression_gen_format =
 	    min::line_gen_format;
 	parser->input_flags = PAR::INPUT_DEFAULTS;
@@ -1175,6 +1176,7 @@ inline void init_input ( PAR::parser parser )
 		 " init_input_..." );
 
     LEX::scanner scanner = parser->scanner;
+    LEX::close_input ( scanner );
     if ( parser->input_file != scanner->input_file )
     {
 	if ( parser->input_file == min::NULL_STUB )
@@ -1253,6 +1255,23 @@ bool PAR::init_input_named_file
 	  file_name, line_format, spool_lines );
 }
 
+bool PAR::init_input_mapped_file
+	( PAR::parser parser,
+	  min::gen file_name,
+	  const min::line_format * line_format,
+	  min::uns32 spool_lines )
+{
+    ::init_input ( parser );
+
+    if ( ! LEX::init_input_mapped_file
+	       ( scanner_ref(parser), file_name,
+	         line_format, spool_lines ) )
+        return false;
+    input_file_ref(parser) =
+        parser->scanner->input_file;
+    return true;
+}
+
 void PAR::init_input_string
 	( PAR::parser parser,
 	  min::ptr<const char> data,
@@ -1354,6 +1373,58 @@ inline TAB::flags output_trace_flags
     return trace_flags;
 }
 
+// For streaming, find the first line still referenced
+// by a token, the message header, or scanner input
+// not yet scanned, update the high-water marks, and
+// release the spooled lines before it.
+//
+static void release_input ( PAR::parser parser )
+{
+    min::uns32 first_line =
+        parser->input_file->next_line_number;
+    min::uns32 scanner_line =
+        LEX::input_position
+	    ( parser->scanner, parser->scanner->next )
+	    .line;
+    if ( scanner_line < first_line )
+        first_line = scanner_line;
+    min::uns32 tokens = 0;
+
+    PAR::token t = parser->first;
+    if ( t != NULL_STUB ) do
+    {
+        ++ tokens;
+	if ( t->type != LEXSTD::start_of_file_t
+	     &&
+	     t->position.begin.line < first_line )
+	    first_line = t->position.begin.line;
+	t = t->next;
+    } while ( t != parser->first );
+
+    if (    parser->message_header.begin
+         != min::MISSING_POSITION
+	 &&
+	    parser->message_header.begin.line
+	 < first_line )
+        first_line =
+	    parser->message_header.begin.line;
+
+    min::uns32 spooled =
+          parser->input_file->next_line_number
+	- parser->spool_first_line;
+    if ( spooled > parser->max_spooled_lines )
+        parser->max_spooled_lines = spooled;
+    if ( tokens > parser->max_live_tokens )
+        parser->max_live_tokens = tokens;
+
+    if ( first_line > parser->spool_first_line )
+    {
+	min::flush_spool
+	    ( parser->input_file, first_line );
+	parser->spool_first_line = first_line;
+    }
+}
+
 void PAR::parse ( PAR::parser parser )
 {
     MIN_ASSERT ( parser != min::NULL_STUB,
@@ -1420,6 +1491,9 @@ void PAR::parse ( PAR::parser parser )
 	min::MISSING_POSITION;
     parser->eof = false;
     parser->finished_tokens = 0;
+    parser->spool_first_line = 0;
+    parser->max_spooled_lines = 0;
+    parser->max_live_tokens = 0;
 
     for ( PAR::pass pass = parser->pass_stack;
     	  pass != min::NULL_STUB;
@@ -1548,10 +1622,25 @@ void PAR::parse ( PAR::parser parser )
 		( PAR::remove
 		    ( PAR::first_ref ( parser ),
 		      output ) );
+
+	if ( parser->streaming )
+	    ::release_input ( parser );
     }
 
 END_PARSE:
 
+    if ( parser->streaming
+         &&
+	 (   parser->trace_flags
+	   & PAR::TRACE_PARSER_INPUT ) )
+	parser->printer
+	    << min::bom
+	    << "STREAMING: max spooled lines "
+	    << parser->max_spooled_lines
+	    << ", max live tokens "
+	    << parser->max_live_tokens
+	    << min::eom;
+
     for ( PAR::pass pass = parser->pass_stack;
     	  pass != min::NULL_STUB;
 	  pass = pass->next )
@@ -2786,9 +2875,10 @@ min::gen PAR::scan_name_string_label
 	       parser->scanner->printer );
     }
 
-    LEX::init_input_string
+    LEX::init_input_span
 	( name_scanner_ref ( parser ),
 	  min::begin_ptr_of ( sp ),
+	  min::strlen ( sp ),
 	  parser->input_file->line_format );
 
     return LEX::scan_name_string
@@ -2,7 +2,7 @@
 //
 // File:	ll_parser_bracketed.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Sat May 24 03:54:04 AM EDT 2025
+// Date:	Sun Oct 18 07:31:52 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -7329,9 +7329,10 @@ static min::gen bracketed_pass_command
 		       parser->scanner->printer );
 	    }
 
-	    LEX::init_input_string
+	    LEX::init_input_span
 		( name_scanner_ref ( parser ),
 		  min::new_ptr ( buffer ),
+		  2 * middlel,
 		  parser->input_file->line_format );
 
 	    double_middle =
@@ -2,7 +2,7 @@
 //
 // File:	ll_parser_standard_input.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Sat May 24 05:36:18 PM EDT 2025
+// Date:	Mon Oct 19 09:12:40 AM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -84,10 +84,15 @@ void PARSTD::init_input
     PARSTD::parser_ref(PARSTD::default_erroneous_atom) =
         parser;
 
-    LEXSTD::init_standard_program();
+    LEXSTD::init_standard_program
+        ( NULL, LEXSTD::default_compiled_program );
     LEX::init_program
 	( PAR::scanner_ref(parser),
           LEXSTD::default_program );
+    LEX::init_compiled_program
+	( parser->scanner,
+          LEXSTD::default_compiled_program );
+    parser->scanner->lazy_translation = true;
     input_ref(parser) = PARSTD::input;
     LEX::erroneous_atom_ref(parser->scanner) =
         (LEX::erroneous_atom)
@@ -159,6 +164,47 @@ inline bool is_digit ( min::Uchar c )
     if ( '0' <= c && c <= '9' ) return true;
     return false;
 }
+// The scanner has lazy_translation set, so the
+// translation of the lexeme just scanned may be left
+// in the input.  The following return its length, its
+// i'th character, and its string, taking identity
+// translations directly from the input.
+//
+inline min::uns32 translation_length
+	( LEX::scanner scanner,
+	  min::uns32 first, min::uns32 next )
+{
+    return scanner->translation_is_identity ?
+           next - first :
+	   scanner->translation_buffer->length;
+}
+inline min::Uchar translation_character
+	( LEX::scanner scanner,
+	  min::uns32 first, min::uns32 i )
+{
+    return scanner->translation_is_identity ?
+           LEX::input_character ( scanner, first + i ) :
+	   scanner->translation_buffer[i];
+}
+static min::gen translation_string
+	( LEX::scanner scanner,
+	  min::uns32 first, min::uns32 next )
+{
+    LEX::translation_buffer translation_buffer =
+        scanner->translation_buffer;
+    if ( ! scanner->translation_is_identity )
+        return min::new_str_gen
+	    ( min::begin_ptr_of ( translation_buffer ),
+	      translation_buffer->length );
+
+    min::uns32 length = next - first;
+    min::Uchar buffer[length+1];
+    for ( min::uns32 i = 0; i < length; ++ i )
+        buffer[i] =
+	    LEX::input_character ( scanner, first + i );
+    return min::new_str_gen ( buffer, length );
+}
+
 static min::uns32 input_add_tokens
 	( PAR::parser parser, PAR::input input )
 {
@@ -166,8 +212,6 @@ static min::uns32 input_add_tokens
 
     LEX::scanner scanner = parser->scanner;
     min::printer printer = parser->printer;
-    LEX::input_buffer input_buffer =
-        scanner->input_buffer;
     LEX::translation_buffer translation_buffer =
         scanner->translation_buffer;
     bool trace = (   parser->trace_flags
@@ -236,17 +280,11 @@ SCAN_NEXT_LEXEME:
 
 	token = PAR::new_token( type );
 	token->position.begin =
-	    first < input_buffer->length ?
-	    input_buffer[first] :
-	    scanner->next_position;
+	    LEX::input_position ( scanner, first );
 	token->position.end =
-	    next < input_buffer->length ?
-	    input_buffer[next] :
-	    scanner->next_position;
+	    LEX::input_position ( scanner, next );
 	token->indent =
-	    next < input_buffer->length ?
-	    (&input_buffer[next])->indent :
-	    scanner->next_indent;
+	    LEX::input_indent ( scanner, next );
 
 	TAB::root r =
 	    ( type < lexeme_map_length ?
@@ -290,6 +328,7 @@ SCAN_NEXT_LEXEME:
 	{
 	case LEXSTD::numeric_t:
 	{
+	    LEX::expand_translation ( scanner );
 	    min::uns32 length =
 	        translation_buffer->length;
 	    if (    length >= 2
@@ -542,10 +581,8 @@ SCAN_NEXT_LEXEME:
 	case LEXSTD::separator_t:
 	case LEXSTD::quoted_string_t:
 	{
-	    value_ref(token) = min::new_str_gen
-	        ( min::begin_ptr_of
-		      ( translation_buffer ),
-		  translation_buffer->length );
+	    value_ref(token) = ::translation_string
+	        ( scanner, first, next );
 
 	    break;
 	}
@@ -553,10 +590,8 @@ SCAN_NEXT_LEXEME:
 	case LEXSTD::number_t:
 	case LEXSTD::numeric_word_t:
 	{
-	    value_ref(token) = min::new_str_gen
-	        ( min::begin_ptr_of
-		      ( translation_buffer ),
-		  translation_buffer->length );
+	    value_ref(token) = ::translation_string
+	        ( scanner, first, next );
 
 	    min::float64 v;
 	    if ( ! min::strto ( v, token->value ) )
@@ -602,27 +637,31 @@ SCAN_NEXT_LEXEME:
 	}
 	case LEXSTD::word_t:
 	{
-	    min::uns32 length =
-	        translation_buffer->length;
-	    value_ref(token) = min::new_str_gen
-	        ( min::begin_ptr_of
-		      ( translation_buffer ),
-		  length );
+	    min::uns32 length = ::translation_length
+	        ( scanner, first, next );
+	    value_ref(token) = ::translation_string
+	        ( scanner, first, next );
 	    if (    length >= 4
-	         &&    translation_buffer[0]
+	         &&    ::translation_character
+		           ( scanner, first, 0 )
 		    == ID_character
-	         &&    translation_buffer[1]
+	         &&    ::translation_character
+		           ( scanner, first, 1 )
 		    == '<'
-	         &&    translation_buffer[length-1]
+	         &&    ::translation_character
+		           ( scanner, first, length-1 )
 		    == '>'
-	         && is_letter ( translation_buffer[2] )
+	         && is_letter
+		        ( ::translation_character
+			      ( scanner, first, 2 ) )
 	       )
 	    {
 		min::uns32 i;
 		for ( i = 3; i < length-1; ++ i )
 		{
 		    min::Uchar c =
-			translation_buffer[i];
+			::translation_character
+			    ( scanner, first, i );
 		    if ( is_letter ( c ) ) continue;
 		    if ( is_digit ( c ) ) continue;
 		    break;
@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_c++_test.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Tue May 23 05:41:30 EDT 2023
+// Date:	Mon Oct 19 13:44:08 EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -13,6 +13,10 @@
 # include <ll_lexeme_c++.h>
 # include <iostream>
 # include <cassert>
+# include <cstring>
+# include <string>
+# include <algorithm>
+# include <iterator>
 # define LEX ll::lexeme
 # define LEXCPP ll::lexeme::cpp
 
@@ -25,6 +29,29 @@ int main ( int argc, const char * argv[] )
     LEXCPP::init_cpp_program();
     LEX::init_program ( LEX::default_scanner,
                         LEXCPP::default_program );
+
+    // With -r, test LEX::rescan_lines on the input as
+    // per LEX::test_rescan, editing the line after the
+    // first line with a /* comment, which should be
+    // inside the comment.
+    //
+    if ( argc > 1 && strcmp ( argv[1], "-r" ) == 0 )
+    {
+	std::string text
+	    ( ( std::istreambuf_iterator<char>
+		    ( std::cin ) ),
+	      std::istreambuf_iterator<char>() );
+	std::string::size_type p = text.find ( "/*" );
+	if ( p == std::string::npos )
+	    p = text.size();
+	LEX::uns32 line =
+	    std::count ( text.begin(),
+	                 text.begin() + p, '\n' );
+	LEX::test_rescan
+	    ( text, line + 1, LEXCPP::end_of_file_t );
+	return 0;
+    }
+
     LEX::init_input_stream
         ( LEX::default_scanner,
 	  std::cin,
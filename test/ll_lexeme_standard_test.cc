@@ -2,7 +2,7 @@
 //
 // File:	ll_lexeme_standard_test.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Tue May 23 05:38:00 EDT 2023
+// Date:	Mon Oct 19 01:44:08 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -13,21 +13,454 @@
 # include <ll_lexeme_standard.h>
 # include <iostream>
 # include <cassert>
+# include <cstring>
+# include <string>
+# include <vector>
+# include <iterator>
+# include <fstream>
+# include <algorithm>
 # define LEX ll::lexeme
 # define LEXSTD ll::lexeme::standard
 
+// Scan text with LEX::scan and then again with LEX::
+// scan_batch, and print whether the lexeme types,
+// positions, and translations are the same.
+//
+static min::packed_vec<LEX::Uchar> translations_type
+    ( "translations_type" );
+
+struct scanned_lexeme
+{
+    LEX::uns32 type;
+    min::position begin, end;
+    std::vector<LEX::Uchar> translation;
+};
+
+static void batch_test ( const std::string & text )
+{
+    LEX::scanner scanner = LEX::default_scanner;
+    std::vector<scanned_lexeme> lexemes;
+
+    LEX::init_input_string
+	( LEX::default_scanner,
+	  min::new_ptr ( text.c_str() ),
+	  min::eol_line_format );
+    while ( true )
+    {
+	scanned_lexeme s;
+	LEX::uns32 first, next;
+        s.type = LEX::scan ( first, next );
+	if ( s.type == LEX::SCAN_ERROR ) break;
+	s.begin = LEX::input_position ( scanner, first );
+	s.end = LEX::input_position ( scanner, next );
+	LEX::translation_buffer tb =
+	    scanner->translation_buffer;
+	for ( LEX::uns32 i = 0; i < tb->length; ++ i )
+	    s.translation.push_back ( tb[i] );
+	lexemes.push_back ( s );
+	if ( s.type == LEXSTD::end_of_file_t ) break;
+    }
+
+    min::locatable_var<LEX::translation_buffer>
+        translations
+	    ( translations_type.new_stub() );
+    const LEX::uns32 N = 7;
+    LEX::batch_lexeme batch[N];
+    LEX::uns64 stop_types =
+        LEX::uns64 ( 1 ) << LEXSTD::end_of_file_t;
+
+    LEX::init_input_string
+	( LEX::default_scanner,
+	  min::new_ptr ( text.c_str() ),
+	  min::eol_line_format );
+    std::size_t count = 0;
+    bool same = true;
+    bool done = false;
+    while ( same && ! done )
+    {
+	min::pop ( translations, translations->length );
+        LEX::uns32 r = LEX::scan_batch
+	    ( batch, N, translations, stop_types );
+	for ( LEX::uns32 j = 0; same && j < r; ++ j )
+	{
+	    LEX::batch_lexeme & b = batch[j];
+	    if ( count >= lexemes.size() )
+	    {
+	        same = false;
+		break;
+	    }
+	    scanned_lexeme & s = lexemes[count++];
+	    same = ( b.type == s.type
+		     &&
+		        LEX::input_position
+			    ( scanner, b.first )
+		     == s.begin
+		     &&
+		        LEX::input_position
+			    ( scanner, b.next )
+		     == s.end
+		     &&
+		        b.translation_length
+		     == s.translation.size() );
+	    for ( LEX::uns32 i = 0;
+	          same && i < b.translation_length;
+		  ++ i )
+	        same = (    translations
+		                [b.translation_offset + i]
+			 == s.translation[i] );
+	    if ( b.type == LEX::SCAN_ERROR
+	         ||
+		 b.type == LEXSTD::end_of_file_t )
+	        done = true;
+	}
+    }
+    if ( count != lexemes.size() ) same = false;
+
+    scanner->printer
+        << "scan_batch lexemes "
+	<< ( same ? "are" : "are NOT" )
+	<< " the same as scan lexemes";
+    if ( ! same )
+        scanner->printer
+	    << " from lexeme " << count << " of "
+	    << lexemes.size();
+    scanner->printer << min::eol;
+}
+
+// Erroneous atom closure that just counts.
+//
+static min::locatable_var<LEX::erroneous_atom>
+    counting_erroneous_atom;
+
+static void count_erroneous_atom
+	( LEX::uns32 first, LEX::uns32 next,
+	  LEX::uns32 type,
+	  LEX::scanner scanner,
+	  LEX::erroneous_atom erroneous_atom )
+{
+    ++ erroneous_atom->count;
+}
+
+// Memory map the named file, scan it with LEX::scan,
+// and then with LEX::scan_parallel for several numbers
+// of workers, first from the mapped file and then
+// from span input, and print for each whether the
+// lexeme types, positions, and translations, and the
+// numbers of erroneous atoms announced, are the same.
+//
+static void parallel_test ( const char * file_name )
+{
+    LEX::scanner scanner = LEX::default_scanner;
+    min::locatable_gen name
+        ( min::new_str_gen ( file_name ) );
+    LEX::init ( ::counting_erroneous_atom,
+                ::count_erroneous_atom );
+
+    if ( ! LEX::init_input_mapped_file
+               ( LEX::default_scanner, name ) )
+    {
+        std::cout << min::error_message;
+	return;
+    }
+    LEX::erroneous_atom_ref(scanner) =
+        ::counting_erroneous_atom;
+    ::counting_erroneous_atom->count = 0;
+    std::vector<scanned_lexeme> lexemes;
+    while ( true )
+    {
+	scanned_lexeme s;
+	LEX::uns32 first, next;
+        s.type = LEX::scan ( first, next );
+	if ( s.type == LEX::SCAN_ERROR )
+	{
+	    s.begin = s.end =
+	        LEX::input_position
+		    ( scanner, scanner->next );
+	    lexemes.push_back ( s );
+	    break;
+	}
+	s.begin = LEX::input_position ( scanner, first );
+	s.end = LEX::input_position ( scanner, next );
+	LEX::translation_buffer tb =
+	    scanner->translation_buffer;
+	for ( LEX::uns32 i = 0; i < tb->length; ++ i )
+	    s.translation.push_back ( tb[i] );
+	lexemes.push_back ( s );
+	if ( s.type == LEXSTD::end_of_file_t ) break;
+    }
+    LEX::uns64 serial_count =
+        ::counting_erroneous_atom->count;
+
+    std::ifstream in ( file_name );
+    std::string text
+        ( ( std::istreambuf_iterator<char> ( in ) ),
+	  std::istreambuf_iterator<char>() );
+
+    const LEX::uns32 workers[] = { 1, 2, 3, 4, 7 };
+    const unsigned n =
+        sizeof ( workers ) / sizeof ( workers[0] );
+    for ( unsigned v = 0; v < 2 * n; ++ v )
+    {
+	unsigned w = v % n;
+	bool span = ( v >= n );
+	min::locatable_var<LEX::parallel_lexemes>
+	    plexemes;
+	min::locatable_var<LEX::translation_buffer>
+	    translations;
+	if ( span )
+	    LEX::init_input_span
+		( LEX::default_scanner,
+		  min::new_ptr ( text.c_str() ),
+		  text.size() );
+	else
+	    LEX::init_input_mapped_file
+		( LEX::default_scanner, name );
+	LEX::erroneous_atom_ref(scanner) =
+	    ::counting_erroneous_atom;
+	::counting_erroneous_atom->count = 0;
+	LEX::scan_parallel
+	    ( plexemes, translations,
+	      LEXSTD::end_of_file_t, workers[w] );
+
+	bool same =
+	    ( plexemes->length == lexemes.size()
+	      &&
+	         ::counting_erroneous_atom->count
+	      == serial_count );
+	for ( LEX::uns32 j = 0;
+	      same && j < plexemes->length; ++ j )
+	{
+	    min::ptr<LEX::parallel_lexeme> p =
+	        & plexemes[j];
+	    scanned_lexeme & s = lexemes[j];
+	    same = ( p->type == s.type
+		     &&
+		     p->begin == s.begin
+		     &&
+		     p->end == s.end
+		     &&
+		        p->translation_length
+		     == s.translation.size() );
+	    for ( LEX::uns32 i = 0;
+	          same && i < p->translation_length;
+		  ++ i )
+	        same = (    translations
+		                [p->translation_offset + i]
+			 == s.translation[i] );
+	}
+
+	scanner->printer
+	    << "scan_parallel "
+	    << ( span ? "of span input " : "" )
+	    << "with " << workers[w]
+	    << ( workers[w] == 1 ? " worker" :
+	                           " workers" )
+	    << ": lexemes "
+	    << ( same ? "are" : "are NOT" )
+	    << " the same as scan lexemes" << min::eol;
+    }
+}
+
+// Write the standard program to the named image file,
+// read the image back, and print whether the program_
+// hash values are the same.
+//
+static int image_test ( const char * file_name )
+{
+    if ( ! LEX::write_program_image
+               ( file_name, LEXSTD::default_program ) )
+    {
+        std::cout << min::error_message;
+	return 1;
+    }
+    min::locatable_var<LEX::program> program;
+    if ( ! LEX::read_program_image
+               ( file_name, program ) )
+    {
+        std::cout << min::error_message;
+	return 1;
+    }
+    std::cout << "program image hash "
+              << (    LEX::program_hash ( program )
+	           == LEX::program_hash
+		          ( LEXSTD::default_program ) ?
+		  "is" : "is NOT" )
+	      << " the same as program hash"
+	      << std::endl;
+    return 0;
+}
+
 int main ( int argc, const char * argv[] )
 {
     min::initialize();
     LEX::init_ostream
 	    ( LEX::default_scanner, std::cout )
         << min::ascii;
-    LEXSTD::init_standard_program();
+
+    // With -i FILE, the standard program is read from
+    // the program image FILE (see LEXSTD::init_
+    // standard_program).  With -w FILE, the program is
+    // written to the image FILE and read back by
+    // image_test above, and nothing is scanned.
+    //
+    // With -o, the program is optimized by LEX::
+    // optimize_program before it is used, and the
+    // compiled dispatch code, which no longer matches
+    // it, is not used.
+    //
+    const char * image_file = NULL;
+    if ( argc > 2 && strcmp ( argv[1], "-i" ) == 0 )
+    {
+        image_file = argv[2];
+	argc -= 2, argv += 2;
+    }
+    LEXSTD::init_standard_program ( image_file );
+    bool optimize =
+        ( argc > 1 && strcmp ( argv[1], "-o" ) == 0 );
+    if ( optimize )
+    {
+        if ( ! LEX::optimize_program
+	           ( LEXSTD::default_program,
+		     LEX::default_scanner->printer ) )
+	{
+	    std::cout << min::error_message;
+	    return 1;
+	}
+	-- argc, ++ argv;
+    }
+    if ( argc > 2 && strcmp ( argv[1], "-w" ) == 0 )
+        return ::image_test ( argv[2] );
+
     LEX::init_program ( LEX::default_scanner,
                         LEXSTD::default_program );
-    LEX::init_input_stream
-        ( LEX::default_scanner,
-	  std::cin,
+    if ( ! optimize )
+	LEX::init_compiled_program
+	    ( LEX::default_scanner,
+	      & LEXSTD::compiled_default_program );
+
+    // With -p, print a profile of the program's hot
+    // components after scanning.
+    //
+    // With -c, profile counts only (no clock ticks).
+    // The input is scanned twice, the second time
+    // without printing, the two sets of counts are
+    // compared, and the hot components are printed
+    // with the counts, which are deterministic.
+    //
+    // With -b, scan the input with both LEX::scan and
+    // LEX::scan_batch and print whether the lexemes
+    // are the same.
+    //
+    // With -P FILE, scan FILE with both LEX::scan and
+    // LEX::scan_parallel as per parallel_test above.
+    //
+    // With -r, test LEX::rescan_lines on the input as
+    // per LEX::test_rescan, editing its middle line.
+    //
+    bool profile =
+        ( argc > 1 && strcmp ( argv[1], "-p" ) == 0 );
+    bool counts =
+        ( argc > 1 && strcmp ( argv[1], "-c" ) == 0 );
+    bool batch =
+        ( argc > 1 && strcmp ( argv[1], "-b" ) == 0 );
+    bool rescan =
+        ( argc > 1 && strcmp ( argv[1], "-r" ) == 0 );
+
+    if ( argc > 2 && strcmp ( argv[1], "-P" ) == 0 )
+    {
+        ::parallel_test ( argv[2] );
+	return 0;
+    }
+
+    if ( ! counts && ! batch && ! rescan )
+    {
+	LEX::init_input_stream
+	    ( LEX::default_scanner,
+	      std::cin,
+	      min::eol_line_format );
+	if ( profile )
+	    LEX::init_profile
+		( LEX::default_scanner, true, true );
+
+	LEX::test_input ( LEXSTD::end_of_file_t );
+
+	if ( profile )
+	    LEX::print_program_profile
+		( LEX::default_scanner->printer,
+		  LEXSTD::default_program,
+		  LEX::default_scanner->profile,
+		  true, true );
+	return 0;
+    }
+
+    std::string text
+        ( ( std::istreambuf_iterator<char>
+	        ( std::cin ) ),
+	  std::istreambuf_iterator<char>() );
+
+    if ( batch )
+    {
+        ::batch_test ( text );
+	return 0;
+    }
+    if ( rescan )
+    {
+	LEX::uns32 lines =
+	    std::count ( text.begin(), text.end(), '\n' );
+	if ( ! text.empty() && *text.rbegin() != '\n' )
+	    ++ lines;
+        LEX::test_rescan
+	    ( text, lines / 2, LEXSTD::end_of_file_t );
+	return 0;
+    }
+
+    LEX::init_input_string
+	( LEX::default_scanner,
+	  min::new_ptr ( text.c_str() ),
 	  min::eol_line_format );
+    LEX::init_profile
+	( LEX::default_scanner, true, false );
     LEX::test_input ( LEXSTD::end_of_file_t );
+
+    LEX::profile profile1 =
+        LEX::default_scanner->profile;
+    std::vector<min::uns64> first_counts
+        ( profile1->length );
+    for ( min::uns32 i = 0; i < profile1->length; ++ i )
+        first_counts[i] = profile1[i];
+
+    LEX::init_input_string
+	( LEX::default_scanner,
+	  min::new_ptr ( text.c_str() ),
+	  min::eol_line_format );
+    LEX::init_profile
+	( LEX::default_scanner, true, false );
+    while ( true )
+    {
+	LEX::uns32 first, next;
+        LEX::uns32 type = LEX::scan ( first, next );
+	if ( type == LEX::SCAN_ERROR
+	     ||
+	     type == LEXSTD::end_of_file_t )
+	    break;
+    }
+
+    LEX::profile profile2 =
+        LEX::default_scanner->profile;
+    bool same =
+        ( profile2->length == first_counts.size() );
+    for ( min::uns32 i = 0;
+          same && i < profile2->length; ++ i )
+        same = ( first_counts[i] == profile2[i] );
+
+    LEX::default_scanner->printer
+        << "profile counts "
+	<< ( same ? "are" : "are NOT" )
+	<< " the same on rescan" << min::eol;
+
+    LEX::print_program_profile
+	( LEX::default_scanner->printer,
+	  LEXSTD::default_program,
+	  LEX::default_scanner->profile,
+	  true, true );
 }
@@ -2,15 +2,20 @@
 //
 // File:	ll_parser_input_test.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Sat May 24 09:20:49 PM EDT 2025
+// Date:	Mon Oct 19 12:48:15 AM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
 // for this program.
 
-// ll_parser_input_test [-m]
+// ll_parser_input_test [-m] [-e] [-s]
 //
 // 	-m enables standard lexeme map
+// 	-e turns off scanner lazy_translation, so
+// 	   every translation is eagerly copied into
+// 	   the translation buffer
+// 	-s sets parser->streaming, so spooled input
+// 	   lines are released as they are parsed
 
 # include <ll_parser.h>
 # include <ll_parser_standard.h>
@@ -38,6 +43,11 @@ int main ( int argc, const char * argv[] )
 	    components +=
 	          PARSTD::ID + PARSTD::TABLE
 		+ PARSTD::LEXEME_MAP;
+        else if ( strcmp ( argv[1], "-e" ) == 0 )
+	    PAR::default_parser->scanner
+	       ->lazy_translation = false;
+        else if ( strcmp ( argv[1], "-s" ) == 0 )
+	    PAR::default_parser->streaming = true;
 	else
 	{
 	    cout << "ERROR: BAD ARGUMENT " << argv[1]
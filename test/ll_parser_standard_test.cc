@@ -2,7 +2,7 @@
 //
 // File:	ll_parser_standard_test.cc
 // Author:	Bob Walton (walton@acm.org)
-// Date:	Mon May 26 11:43:06 PM EDT 2025
+// Date:	Mon Oct 19 12:07:44 PM EDT 2026
 //
 // The authors have placed this program in the public
 // domain; they make no warranty and accept no liability
@@ -13,6 +13,7 @@
 # include <mexcom.h>
 # include <iostream>
 # include <cassert>
+# define LEX ll::lexeme
 # define PAR ll::parser
 # define PARSTD ll::parser::standard
 using std::cout;
@@ -22,9 +23,29 @@ int main ( int argc, const char * argv[] )
     min::initialize();
     PAR::init ( PAR::default_parser, PARSTD::ALL );
 
-    PAR::init_input_stream
-        ( PAR::default_parser, std::cin,
-	  min::marked_line_format );
+    // With an argument, the named file is memory
+    // mapped as input.  Its file name is cleared so
+    // messages print the same as for standard input.
+    //
+    if ( argc > 1 )
+    {
+	if ( ! PAR::init_input_mapped_file
+		   ( PAR::default_parser,
+		     min::new_str_gen ( argv[1] ),
+		     min::marked_line_format ) )
+	{
+	    cout << min::error_message;
+	    return 1;
+	}
+	min::init_file_name
+	    ( LEX::input_file_ref
+		  ( PAR::default_parser->scanner ),
+	      min::MISSING() );
+    }
+    else
+	PAR::init_input_stream
+	    ( PAR::default_parser, std::cin,
+	      min::marked_line_format );
     PAR::init_printer_ostream
         ( PAR::default_parser, std::cout );
 